@@ -6,77 +6,103 @@
 /* Kenneth C. Louden                                */
 /****************************************************/
 
+#include <limits.h>
+#include <pthread.h>
 #include "globals.h"
 #include "symtab.h"
 #include "analyze.h"
 #include "util.h"
+#include "diag.h"
+#include "incr.h"
 
 #define DEBUG 0
 
-static int scopeFlag = 0;
-static char *funcName = NULL;
-BucketList l = NULL;
-ScopeList sc = NULL;
+/* the state of the function being analyzed;
+ * each typeCheck worker thread has its own
+ */
+static _Thread_local int scopeFlag = 0;
+static _Thread_local char *funcName = NULL;
+static _Thread_local BucketList funcSym = NULL;
+
+/* worker is set in typeCheck worker threads,
+ * whose diagnostics go to per-declaration buffers
+ */
+static _Thread_local int worker = FALSE;
+
+static ScopeList globalScope = NULL;
+
+/* visits counts the nodes traversed by the
+ * calling thread
+ */
+static _Thread_local long visits = 0;
 
-void addInput();
-void addOutput();
+/* exprType[t->id] is the type of the value of
+ * node t, filled in postorder by checkNode
+ */
+static ExpType *exprType = NULL;
+static int exprTypeSize = 0;
 
-typedef enum
+/* opResult[l][r] is the type of an operator
+ * applied to operands of types l and r, or -1
+ * if the operation is invalid
+ */
+static const signed char opResult[4][4] = {
+    /* l \ r       Void  Integer  VoidArr  IntegerArr */
+    /* Void */      {-1,  -1,      -1,      -1},
+    /* Integer */   {-1,  Integer, -1,      -1},
+    /* VoidArr */   {-1,  -1,      -1,      -1},
+    /* IntegerArr */{-1,  -1,      -1,      -1},
+};
+
+/* indexResult[d] is the type of an element of a
+ * variable declared with type d, or -1 if it
+ * cannot be indexed
+ */
+static const signed char indexResult[4] = {Void, -1, VoidArr, Integer};
+
+/* Procedure allocTypes makes room in exprType
+ * for every tree node created so far
+ */
+static void allocTypes(void)
 {
-  UndecFunc,
-  UndecVar,
-  RedefSym,
-  VoidVar,
-  NoIntIdx,
-  NoArrIdx,
-  InvalCall,
-  InvalReturn,
-  InvalAssign,
-  InvalOper,
-  InvalCond,
-} ErrorKind;
-
-static void semanticError(ErrorKind err, char *name, int lineno)
+  free(exprType);
+  exprTypeSize = maxNodeId() + 1;
+  exprType = (ExpType *)calloc(exprTypeSize, sizeof(ExpType));
+}
+
+/* Function typeOf returns the type computed for
+ * node t by the analysis; declarations that
+ * were not part of the tree (built-ins) have
+ * their declared type
+ */
+ExpType typeOf(TreeNode *t)
 {
-  switch (err)
-  {
-  case UndecFunc:
-    fprintf(listing, "Error: undeclared function \"%s\" is called at line %d\n", name, lineno);
-    break;
-  case UndecVar:
-    fprintf(listing, "Error: undeclared variable \"%s\" is used at line %d\n", name, lineno);
-    break;
-  case RedefSym:
-    fprintf(listing, "Error: Symbol \"%s\" is redefined at line %d\n", name, lineno);
-    break;
-  case VoidVar:
-    fprintf(listing, "Error: The void-type variable is declared at line %d (name : \"%s\")\n", lineno, name);
-    break;
-  case NoIntIdx:
-    fprintf(listing, "Error: Invalid array indexing at line %d (name : \"%s\"). indicies should be integer\n", lineno, name);
-    break;
-  case NoArrIdx:
-    fprintf(listing, "Error: Invalid array indexing at line %d (name : \"%s\"). indexing can only allowed for int[] variables\n", lineno, name);
-    break;
-  case InvalCall:
-    fprintf(listing, "Error: Invalid function call at line %d (name : \"%s\")\n", lineno, name);
-    break;
-  case InvalReturn:
-    fprintf(listing, "Error: Invalid return at line %d\n", lineno);
-    break;
-  case InvalAssign:
-    fprintf(listing, "Error: invalid assignment at line %d\n", lineno);
-    break;
-  case InvalOper:
-    fprintf(listing, "Error: invalid operation at line %d\n", lineno);
-    break;
-  case InvalCond:
-    fprintf(listing, "Error: invalid condition at line %d\n", lineno);
-    break;
-  default:
-    break;
-  }
-  Error = TRUE;
+  if (t->id <= 0 || t->id >= exprTypeSize)
+    return t->type;
+  return exprType[t->id];
+}
+
+
+/* nullProc is a do-nothing procedure to
+ * generate preorder-only or postorder-only
+ * traversals from traverse
+ */
+static void nullProc(TreeNode *t)
+{
+  if (t == NULL)
+    return;
+  else
+    return;
+}
+
+/* Procedure semanticError records an error of
+ * kind err about name at node t
+ */
+static void semanticError(ErrorKind err, char *name, TreeNode *t)
+{
+  diagReport(err, name, t->lineno, t->colno);
+  if (!worker)
+    Error = TRUE;
 }
 
 /* Procedure traverse is a generic recursive
@@ -90,6 +116,7 @@ static void traverse(TreeNode *t,
 {
   if (t != NULL)
   {
+    visits++;
     preProc(t);
     {
       int i;
@@ -101,38 +128,54 @@ static void traverse(TreeNode *t,
   }
 }
 
+/* Function redefined tells whether name is already
+ * declared in currScope; global declarations may
+ * not reuse the name of a built-in either
+ */
+static int redefined(char *name)
+{
+  return st_lookup_excluding_parent(currScope, name) != NULL ||
+         (currScope == globalScope && prelude_lookup(name) != NULL);
+}
+
 /* Procedure insertNode inserts
  * identifiers stored in t into
  * the symbol table
  */
 static void insertNode(TreeNode *t)
 {
+  BucketList l;
   if (t->nodekind == StmtK)
   {
     switch (t->kind.stmt)
     {
     case VarDeclK:
-      if (st_lookup_excluding_parent(currScope, t->attr.name) != NULL)
+      if (redefined(t->attr.name))
       {
-        semanticError(RedefSym, t->attr.name, t->lineno);
+        semanticError(RedefSym, t->attr.name, t);
       }
       else
       {
-        st_insert(currScope, t->attr.name, t->type, t->lineno, t);
+        t->symbol = st_insert(currScope, t->attr.name, t->type, t->lineno, t);
       }
       break;
     case FunDeclK:
-      if (st_lookup_excluding_parent(currScope, t->attr.name) != NULL)
+      if (redefined(t->attr.name))
       {
-        semanticError(RedefSym, t->attr.name, t->lineno);
+        semanticError(RedefSym, t->attr.name, t);
       }
       else
       {
-        st_insert(currScope, t->attr.name, t->type, t->lineno, t);
-        addScope(t->attr.name);
-        scopeFlag = 1;
-        funcName = t->attr.name;
+        t->symbol = st_insert(currScope, t->attr.name, t->type, t->lineno, t);
+        st_setSignature(t->symbol, t->child[0]);
       }
+      /* the body gets a scope even when the name is
+       * redefined, so that it can still be checked
+       */
+      t->scope = addScope(t->attr.name);
+      scopeFlag = 1;
+      funcName = t->attr.name;
+      funcSym = t->symbol != NULL ? t->symbol : st_lookup(globalScope, funcName);
       break;
     case CompK:
       if (scopeFlag == 1)
@@ -143,7 +186,7 @@ static void insertNode(TreeNode *t)
       {
         char buffer[64];
         sprintf(buffer, "%s:%d", funcName, t->lineno);
-        addScope(buffer);
+        t->scope = addScope(buffer);
       }
       break;
     default:
@@ -155,15 +198,19 @@ static void insertNode(TreeNode *t)
     switch (t->kind.exp)
     {
     case ParamK:
-      st_insert(currScope, t->attr.name, t->type, t->lineno, t);
+      t->symbol = st_insert(currScope, t->attr.name, t->type, t->lineno, t);
       break;
     case IdK:
     case CallK:
+      /* resolve the name once; later passes read
+       * t->symbol. A name not declared before its
+       * use stays unresolved, so that every
+       * analysis mode rejects forward references
+       */
       l = st_lookup(currScope, t->attr.name);
       if (l != NULL)
       {
-        t->type = l->type;
-        st_insert(l->scope, t->attr.name, t->type, t->lineno, t);
+        t->symbol = st_insert(l->scope, t->attr.name, l->type, t->lineno, t);
       }
       break;
     default:
@@ -175,7 +222,7 @@ static void insertNode(TreeNode *t)
 static void postProc(TreeNode *t)
 {
   if (t->nodekind == StmtK && t->kind.stmt == CompK)
-    currScope = currScope->parent;
+    leaveScope();
 }
 
 /* Function buildSymtab constructs the symbol
@@ -183,9 +230,9 @@ static void postProc(TreeNode *t)
  */
 void buildSymtab(TreeNode *syntaxTree)
 {
-  addScope("global");
-  addInput();
-  addOutput();
+  currScope = preludeScope();
+  globalScope = addScope("global");
+  allocTypes();
   traverse(syntaxTree, insertNode, postProc);
   if (TraceAnalyze)
   {
@@ -194,16 +241,99 @@ void buildSymtab(TreeNode *syntaxTree)
   }
 }
 
+/* Function isConst tells whether t is an
+ * integer constant
+ */
+static int isConst(TreeNode *t)
+{
+  return t != NULL && t->nodekind == ExpK && t->kind.exp == ConstK;
+}
+
+/* Procedure foldOp turns operation t into a
+ * ConstK node when both operands are constants;
+ * a division by zero is left for checkNode to
+ * report
+ */
+static void foldOp(TreeNode *t)
+{
+  TreeNode *p1, *p2;
+  int a, b, v;
+  if (t->nodekind != ExpK || t->kind.exp != OpK)
+    return;
+  p1 = t->child[0];
+  p2 = t->child[1];
+  if (!isConst(p1) || !isConst(p2) || (t->attr.op == OVER && p2->attr.val == 0))
+    return;
+  a = p1->attr.val;
+  b = p2->attr.val;
+  switch (t->attr.op)
+  {
+  /* the TM wraps around like unsigned arithmetic */
+  case PLUS:
+    v = (int)((unsigned)a + (unsigned)b);
+    break;
+  case MINUS:
+    v = (int)((unsigned)a - (unsigned)b);
+    break;
+  case TIMES:
+    v = (int)((unsigned)a * (unsigned)b);
+    break;
+  case OVER:
+    if (a == INT_MIN && b == -1)
+      return;
+    v = a / b;
+    break;
+  case LT:
+    v = a < b;
+    break;
+  case LE:
+    v = a <= b;
+    break;
+  case GT:
+    v = a > b;
+    break;
+  case GE:
+    v = a >= b;
+    break;
+  case EQ:
+    v = a == b;
+    break;
+  case NE:
+    v = a != b;
+    break;
+  default:
+    return;
+  }
+  t->kind.exp = ConstK;
+  t->attr.val = v;
+  t->child[0] = t->child[1] = NULL;
+  free(p1);
+  free(p2);
+}
+
+/* Function outOfBounds tells whether constant
+ * index i is outside the array l, when l was
+ * declared with a size
+ */
+static int outOfBounds(BucketList l, int i)
+{
+  TreeNode *d = l->treeNode;
+  if (d == NULL || d->nodekind != StmtK || d->kind.stmt != VarDeclK || !isConst(d->child[0]))
+    return FALSE;
+  return i < 0 || i >= d->child[0]->attr.val;
+}
+
 /* Procedure checkNode performs
  * type checking at a single tree node
  */
 static void checkNode(TreeNode *t)
 {
-  TreeNode *param = NULL;
   TreeNode *arg = NULL;
-  ExpType lType;
-  ExpType rType;
-  ScopeList globalScope = findScope("global");
+  int nargs, match;
+  BucketList l;
+  ExpType *type = &exprType[t->id];
+  int r;
+  *type = t->type; /* declarations */
   if (t->nodekind == StmtK)
   {
     switch (t->kind.stmt)
@@ -211,38 +341,34 @@ static void checkNode(TreeNode *t)
     case VarDeclK:
       if (t->type == Void || t->type == VoidArr)
       {
-        semanticError(VoidVar, t->attr.name, t->lineno);
+        semanticError(VoidVar, t->attr.name, t);
       }
       break;
     case CompK:
-      currScope = currScope->parent;
+      leaveScope();
       break;
     case IfK:
     case IfElseK:
     case WhileK:
-      if (t->child[0]->type != Integer)
+      if (typeOf(t->child[0]) != Integer)
       {
-        semanticError(InvalCond, "", t->lineno);
+        semanticError(InvalCond, "", t);
       }
       break;
     case ReturnK:
-      sc = currScope;
-      while (sc->parent != globalScope)
-      {
-        sc = sc->parent;
-      }
-      l = st_lookup(globalScope, sc->name);
+      l = funcSym;
       if ((t->child[0] != NULL && l->type == Void) ||
           (t->child[0] == NULL && l->type != Void) ||
-          (t->child[0] != NULL && l->type != Void && t->child[0]->type != l->type))
+          (t->child[0] != NULL && l->type != Void && typeOf(t->child[0]) != l->type))
       {
-        semanticError(InvalReturn, "", t->lineno);
+        semanticError(InvalReturn, "", t);
       }
       break;
     case AssignK:
-      if (t->child[0]->type != t->child[1]->type)
+      *type = typeOf(t->child[0]);
+      if (*type != typeOf(t->child[1]))
       {
-        semanticError(InvalAssign, "", t->lineno);
+        semanticError(InvalAssign, "", t);
       }
       break;
     default:
@@ -254,84 +380,71 @@ static void checkNode(TreeNode *t)
     switch (t->kind.exp)
     {
     case OpK:
-      lType = t->child[0]->type;
-      rType = t->child[1]->type;
-
-      if (lType == IntegerArr && t->child[0]->child[0] != NULL)
-      {
-        lType = Integer;
-      }
-      if (rType == IntegerArr && t->child[1]->child[0] != NULL)
+      r = opResult[typeOf(t->child[0])][typeOf(t->child[1])];
+      if (r < 0)
       {
-        rType = Integer;
+        semanticError(InvalOper, "", t);
+        r = Void;
       }
-
-      if (lType != Integer || rType != Integer)
-      {
-        semanticError(InvalOper, "", t->lineno);
-      }
-      else
+      *type = r;
+      if (r == Integer && t->attr.op == OVER && isConst(t->child[1]) &&
+          t->child[1]->attr.val == 0)
       {
-        t->type = Integer;
+        semanticError(DivZero, "", t);
       }
       break;
     case ConstK:
-      t->type = Integer;
+      *type = Integer;
       break;
     case IdK:
-      l = st_lookup(currScope, t->attr.name);
+      l = t->symbol;
       if (l == NULL)
       {
-        semanticError(UndecVar, t->attr.name, t->lineno);
+        semanticError(UndecVar, t->attr.name, t);
         break;
       }
-      t->type = l->type;
+      *type = l->type;
       if (t->child[0] == NULL)
       {
         break;
       }
-      if (l->type == IntegerArr)
+      r = indexResult[l->type];
+      if (r < 0)
       {
-        if (t->child[0]->type != Integer)
-        {
-          semanticError(NoIntIdx, t->attr.name, t->lineno);
-        }
-        t->type -= 2;
+        semanticError(NoArrIdx, t->attr.name, t);
+        break;
       }
-      else if (l->type == Integer)
+      if (l->type == IntegerArr && typeOf(t->child[0]) != Integer)
       {
-        semanticError(NoArrIdx, t->attr.name, t->lineno);
+        semanticError(NoIntIdx, t->attr.name, t);
       }
+      else if (isConst(t->child[0]) && outOfBounds(l, t->child[0]->attr.val))
+      {
+        semanticError(IdxRange, t->attr.name, t);
+      }
+      *type = r;
       break;
     case CallK:
-      l = st_lookup(currScope, t->attr.name);
+      l = t->symbol;
       if (l == NULL)
       {
-        semanticError(UndecFunc, t->attr.name, t->lineno);
+        semanticError(UndecFunc, t->attr.name, t);
         break;
       }
-      t->type = l->type;
-      param = l->treeNode->child[0];
-      arg = t->child[0];
-
-      if (param->kind.exp == VoidParamK)
+      *type = l->type;
+      /* compare the argument types with the
+       * signature recorded at the declaration
+       */
+      match = TRUE;
+      for (nargs = 0, arg = t->child[0]; arg != NULL; arg = arg->sibling)
       {
-        if (arg != NULL)
-        {
-          semanticError(InvalCall, t->attr.name, t->lineno);
-        }
-        break;
+        if (nargs >= l->arity || typeOf(arg) != (ExpType)l->paramTypes[nargs])
+          match = FALSE;
+        nargs++;
       }
-
-      while (param || arg)
+      if (!match || nargs != l->arity)
       {
-        if (!param || !arg || param->type != arg->type)
-        {
-          semanticError(InvalCall, t->attr.name, t->lineno);
-          break;
-        }
-        param = param->sibling;
-        arg = arg->sibling;
+        semanticError(InvalCall, t->attr.name, t);
       }
       break;
     default:
@@ -347,9 +460,10 @@ static void beforeCheckNode(TreeNode *t)
     switch (t->kind.stmt)
     {
     case FunDeclK:
-      currScope = findScope(t->attr.name);
+      enterScope(t->scope);
       scopeFlag = 1;
       funcName = t->attr.name;
+      funcSym = t->symbol != NULL ? t->symbol : st_lookup(globalScope, funcName);
       break;
     case CompK:
       if (scopeFlag == 1)
@@ -358,9 +472,7 @@ static void beforeCheckNode(TreeNode *t)
       }
       else
       {
-        char buffer[64];
-        sprintf(buffer, "%s:%d", funcName, t->lineno);
-        currScope = findScope(buffer);
+        enterScope(t->scope);
       }
     default:
       break;
@@ -373,33 +485,220 @@ static void beforeCheckNode(TreeNode *t)
  */
 void typeCheck(TreeNode *syntaxTree)
 {
-  currScope = findScope("global");
+  currScope = globalScope;
   traverse(syntaxTree, beforeCheckNode, checkNode);
 }
 
-void addInput()
+/* a top-level declaration checked by a worker,
+ * with the diagnostics it produced
+ */
+typedef struct
+{
+  TreeNode *decl;
+  DiagBuffer diags;
+  int clean; /* no diagnostics */
+} CheckJob;
+
+/* the jobs of a parallel typeCheck, claimed
+ * in order by the workers
+ */
+typedef struct
+{
+  CheckJob *jobs;
+  int njobs;
+  int next;
+  pthread_mutex_t lock;
+} JobQueue;
+
+typedef struct
+{
+  pthread_t thread;
+  JobQueue *queue;
+  LookupStats stats;
+  long visits;
+} CheckWorker;
+
+/* Procedure checkDecl type checks a single
+ * top-level declaration, without its siblings
+ */
+static void checkDecl(TreeNode *t)
+{
+  int i;
+  currScope = globalScope;
+  scopeFlag = 0;
+  visits++;
+  beforeCheckNode(t);
+  for (i = 0; i < MAXCHILDREN; i++)
+    traverse(t->child[i], beforeCheckNode, checkNode);
+  checkNode(t);
+}
+
+static void *checkWorker(void *arg)
+{
+  CheckWorker *w = (CheckWorker *)arg;
+  JobQueue *q = w->queue;
+  worker = TRUE;
+  for (;;)
+  {
+    CheckJob *job;
+    pthread_mutex_lock(&q->lock);
+    job = q->next < q->njobs ? &q->jobs[q->next++] : NULL;
+    pthread_mutex_unlock(&q->lock);
+    if (job == NULL)
+      break;
+    diagSetBuffer(&job->diags);
+    checkDecl(job->decl);
+  }
+  diagSetBuffer(NULL);
+  st_takeLookupStats(&w->stats);
+  w->visits = visits;
+  return NULL;
+}
+
+/* Procedure runJobs checks the declarations of
+ * q with nthreads workers and appends their
+ * diagnostics in the order of the jobs
+ */
+static void runJobs(JobQueue *q, int nthreads)
+{
+  CheckWorker *workers;
+  int i;
+  q->next = 0;
+  if (nthreads > q->njobs)
+    nthreads = q->njobs;
+  if (nthreads <= 1)
+  {
+    for (i = 0; i < q->njobs; i++)
+    {
+      diagSetBuffer(&q->jobs[i].diags);
+      checkDecl(q->jobs[i].decl);
+    }
+    diagSetBuffer(NULL);
+  }
+  else
+  {
+    pthread_mutex_init(&q->lock, NULL);
+    workers = (CheckWorker *)calloc(nthreads, sizeof(CheckWorker));
+    for (i = 0; i < nthreads; i++)
+    {
+      workers[i].queue = q;
+      pthread_create(&workers[i].thread, NULL, checkWorker, &workers[i]);
+    }
+    for (i = 0; i < nthreads; i++)
+    {
+      pthread_join(workers[i].thread, NULL);
+      st_addLookupStats(&workers[i].stats);
+      visits += workers[i].visits;
+    }
+    pthread_mutex_destroy(&q->lock);
+    free(workers);
+  }
+  for (i = 0; i < q->njobs; i++)
+  {
+    q->jobs[i].clean = q->jobs[i].diags.count == 0;
+    if (!q->jobs[i].clean)
+      Error = TRUE;
+    diagAppend(&q->jobs[i].diags);
+  }
+}
+
+/* Procedure parallelTypeCheck performs the same
+ * checks as typeCheck with nthreads workers,
+ * each taking whole top-level declarations.
+ * The symbol table is only read, and the
+ * diagnostics of each declaration are buffered
+ * and appended in source order afterwards
+ */
+void parallelTypeCheck(TreeNode *syntaxTree, int nthreads)
 {
-  TreeNode *t = newStmtNode(FunDeclK);
-  TreeNode *param = newExpNode(VoidParamK);
-  TreeNode *comp = newStmtNode(CompK);
-  t->attr.name = "input";
-  t->type = Integer;
-  t->child[0] = param;
-  t->child[1] = comp;
-  t->lineno = 0;
-  st_insert(currScope, t->attr.name, t->type, t->lineno, t);
+  JobQueue q;
+  TreeNode *t;
+  int i;
+  if (nthreads <= 1)
+  {
+    typeCheck(syntaxTree);
+    return;
+  }
+  q.njobs = 0;
+  for (t = syntaxTree; t != NULL; t = t->sibling)
+    q.njobs++;
+  q.jobs = (CheckJob *)calloc(q.njobs, sizeof(CheckJob));
+  for (i = 0, t = syntaxTree; t != NULL; t = t->sibling)
+    q.jobs[i++].decl = t;
+  runJobs(&q, nthreads);
+  free(q.jobs);
 }
 
-void addOutput()
+/* Procedure incrementalTypeCheck type checks
+ * only the declarations that the cache in file
+ * cannot vouch for: changed functions, functions
+ * using a global or function whose signature
+ * changed, and everything that had errors. The
+ * cache is then rewritten with the new results
+ */
+void incrementalTypeCheck(TreeNode *syntaxTree, char *file, int nthreads)
 {
-  TreeNode *t = newStmtNode(FunDeclK);
-  TreeNode *param = newExpNode(ParamK);
-  TreeNode *comp = newStmtNode(CompK);
-  param->type = Integer;
-  t->attr.name = "output";
-  t->type = Void;
-  t->child[0] = param;
-  t->child[1] = comp;
-  t->lineno = 0;
-  st_insert(currScope, t->attr.name, t->type, t->lineno, t);
+  JobQueue q;
+  TreeNode *t;
+  int i, n = 0;
+  incrLoad(file);
+  for (t = syntaxTree; t != NULL; t = t->sibling)
+    n++;
+  q.jobs = (CheckJob *)calloc(n, sizeof(CheckJob));
+  q.njobs = 0;
+  for (t = syntaxTree; t != NULL; t = t->sibling)
+    if (t->nodekind != StmtK || t->kind.stmt != FunDeclK || !incrUnchanged(t))
+      q.jobs[q.njobs++].decl = t;
+  runJobs(&q, nthreads);
+  for (i = 0, t = syntaxTree; t != NULL; t = t->sibling)
+  {
+    if (t->nodekind != StmtK || t->kind.stmt != FunDeclK)
+    {
+      if (i < q.njobs && q.jobs[i].decl == t)
+        i++;
+      continue;
+    }
+    if (i < q.njobs && q.jobs[i].decl == t)
+      incrRecord(q.jobs[i++].clean);
+    else
+      incrRecord(TRUE);
+  }
+  incrSave(file);
+  free(q.jobs);
+}
+
+/* Procedure foldConstants folds the constant
+ * operations of every declaration, in postorder
+ * so that folded operands fold their parents
+ */
+void foldConstants(TreeNode *syntaxTree)
+{
+  traverse(syntaxTree, nullProc, foldOp);
+}
+
+/* Function analyzeVisits returns the number of
+ * nodes visited by the analysis so far
+ */
+long analyzeVisits(void)
+{
+  return visits;
+}
+
+/* Procedure analyze builds the symbol table and
+ * type checks in a single traversal: C-Minus is
+ * declare-before-use, so every name can be
+ * inserted or resolved in preorder and checked
+ * in postorder of the same walk
+ */
+void analyze(TreeNode *syntaxTree)
+{
+  currScope = preludeScope();
+  globalScope = addScope("global");
+  allocTypes();
+  traverse(syntaxTree, insertNode, checkNode);
+  if (TraceAnalyze)
+  {
+    fprintf(listing, "\nSymbol table:\n\n");
+    printSymTab(listing);
+  }
 }
@@ -8,6 +8,16 @@
 #ifndef _ANALYZE_H_
 #define _ANALYZE_H_
 
+/* Procedure foldConstants replaces the
+ * operations on integer constants by their
+ * value throughout the tree. It runs before the
+ * analysis in every mode, so that the checks of
+ * constant indices and divisors and the code
+ * generated do not depend on which functions
+ * are type checked
+ */
+void foldConstants(TreeNode *);
+
 /* Function buildSymtab constructs the symbol
  * table by preorder traversal of the syntax tree
  */
@@ -18,4 +28,38 @@ void buildSymtab(TreeNode *);
  */
 void typeCheck(TreeNode *);
 
+/* Procedure parallelTypeCheck performs typeCheck
+ * with nthreads worker threads, each checking
+ * whole top-level declarations; diagnostics
+ * are reported in source order
+ */
+void parallelTypeCheck(TreeNode *, int nthreads);
+
+/* Procedure incrementalTypeCheck performs
+ * parallelTypeCheck, skipping the functions
+ * that the cache in file from the previous
+ * compilation shows cannot have errors, and
+ * updates the cache
+ */
+void incrementalTypeCheck(TreeNode *, char *file, int nthreads);
+
+/* Procedure analyze builds the symbol table and
+ * performs type checking in a single traversal
+ * (the fused equivalent of buildSymtab followed
+ * by typeCheck)
+ */
+void analyze(TreeNode *);
+
+/* Function analyzeVisits returns the number of
+ * tree nodes visited by the analysis so far,
+ * counting those visited by worker threads
+ */
+long analyzeVisits(void);
+
+/* Function typeOf returns the type of the value
+ * of node t computed by the analysis (the
+ * declared type for declarations)
+ */
+ExpType typeOf(TreeNode *t);
+
 #endif
@@ -0,0 +1,237 @@
+/****************************************************/
+/* File: callgraph.c                                */
+/* Call graph of the C-Minus compiler, used to      */
+/* drop functions unreachable from main and to      */
+/* find the recursive ones                          */
+/****************************************************/
+
+#include "globals.h"
+#include "symtab.h"
+#include "util.h"
+#include "callgraph.h"
+
+/* a function of the program and the functions
+ * it calls, as indices into funcs
+ */
+typedef struct
+{
+  TreeNode *decl;
+  int *callees;
+  int ncallees;
+  int cap;
+  int reached;
+  int index, low; /* Tarjan's numbering, 0 = unvisited */
+  int onStack;
+} CallNode;
+
+static CallNode *funcs = NULL;
+static int nfuncs = 0;
+
+/* funcOf[t->id] is the index of function
+ * declaration t in funcs, -1 for other nodes
+ */
+static int *funcOf = NULL;
+static int funcOfSize = 0;
+
+static int indexOf(TreeNode *decl)
+{
+  if (decl == NULL || decl->id <= 0 || decl->id >= funcOfSize)
+    return -1; /* built-ins */
+  return funcOf[decl->id];
+}
+
+/* Procedure addCalls adds an edge from f to
+ * every function called in t
+ */
+static void addCalls(CallNode *f, TreeNode *t)
+{
+  int i;
+  for (; t != NULL; t = t->sibling)
+  {
+    if (t->nodekind == ExpK && t->kind.exp == CallK && t->symbol != NULL &&
+        (i = indexOf(t->symbol->treeNode)) >= 0)
+    {
+      if (f->ncallees == f->cap)
+      {
+        f->cap = f->cap ? 2 * f->cap : 4;
+        f->callees = (int *)realloc(f->callees, f->cap * sizeof(int));
+      }
+      f->callees[f->ncallees++] = i;
+    }
+    for (i = 0; i < MAXCHILDREN; i++)
+      addCalls(f, t->child[i]);
+  }
+}
+
+/* Procedure buildCallGraph fills in funcs for
+ * the top-level function declarations of tree
+ */
+static void buildCallGraph(TreeNode *tree)
+{
+  TreeNode *t;
+  int i;
+  nfuncs = 0;
+  for (t = tree; t != NULL; t = t->sibling)
+    if (t->nodekind == StmtK && t->kind.stmt == FunDeclK)
+      nfuncs++;
+  funcs = (CallNode *)calloc(nfuncs > 0 ? nfuncs : 1, sizeof(CallNode));
+  funcOfSize = maxNodeId() + 1;
+  funcOf = (int *)malloc(funcOfSize * sizeof(int));
+  memset(funcOf, -1, funcOfSize * sizeof(int));
+  for (i = 0, t = tree; t != NULL; t = t->sibling)
+    if (t->nodekind == StmtK && t->kind.stmt == FunDeclK)
+    {
+      funcs[i].decl = t;
+      funcOf[t->id] = i++;
+    }
+  for (i = 0; i < nfuncs; i++)
+    addCalls(&funcs[i], funcs[i].decl->child[1]);
+}
+
+/* Procedure markReached marks the functions
+ * reachable from funcs[root]
+ */
+static void markReached(int root)
+{
+  int *stack = (int *)malloc(nfuncs * sizeof(int));
+  int top = 0, i;
+  funcs[root].reached = TRUE;
+  stack[top++] = root;
+  while (top > 0)
+  {
+    CallNode *f = &funcs[stack[--top]];
+    for (i = 0; i < f->ncallees; i++)
+      if (!funcs[f->callees[i]].reached)
+      {
+        funcs[f->callees[i]].reached = TRUE;
+        stack[top++] = f->callees[i];
+      }
+  }
+  free(stack);
+}
+
+static void freeCallGraph(void)
+{
+  int i;
+  for (i = 0; i < nfuncs; i++)
+    free(funcs[i].callees);
+  free(funcs);
+  free(funcOf);
+  funcs = NULL;
+  funcOf = NULL;
+  nfuncs = funcOfSize = 0;
+}
+
+/* Function dropUnreachable unlinks the function
+ * declarations unreachable from main and returns
+ * their number
+ */
+int dropUnreachable(TreeNode **syntaxTree)
+{
+  TreeNode **link;
+  int i, root = -1, dropped = 0;
+  buildCallGraph(*syntaxTree);
+  for (i = 0; i < nfuncs; i++)
+    if (strcmp(funcs[i].decl->attr.name, "main") == 0)
+      root = i; /* the last one */
+  if (root < 0)
+  {
+    freeCallGraph();
+    return 0;
+  }
+  markReached(root);
+  link = syntaxTree;
+  while (*link != NULL)
+  {
+    i = indexOf(*link);
+    if (i >= 0 && !funcs[i].reached)
+    {
+      if (TraceAnalyze)
+        fprintf(listing, "Function %s is unreachable from main\n", (*link)->attr.name);
+      *link = (*link)->sibling;
+      dropped++;
+    }
+    else
+      link = &(*link)->sibling;
+  }
+  freeCallGraph();
+  return dropped;
+}
+
+/* Procedure markRecursive sets recursive at the
+ * id of every function on a cycle of calls: in a
+ * strongly connected component of several
+ * functions, or calling itself. It numbers the
+ * components in one walk of the graph (Tarjan's
+ * algorithm, with the path kept on a stack)
+ */
+static void markRecursive(char *recursive)
+{
+  int *path = (int *)malloc(nfuncs * sizeof(int));
+  int *next = (int *)calloc(nfuncs, sizeof(int)); /* callee to visit */
+  int *pending = (int *)malloc(nfuncs * sizeof(int)); /* in no component yet */
+  int npath, nopen = 0, count = 0, root, v, w, k, several;
+  for (root = 0; root < nfuncs; root++)
+  {
+    if (funcs[root].index > 0)
+      continue;
+    funcs[root].index = funcs[root].low = ++count;
+    funcs[root].onStack = TRUE;
+    pending[nopen++] = root;
+    path[0] = root;
+    npath = 1;
+    while (npath > 0)
+    {
+      v = path[npath - 1];
+      if (next[v] < funcs[v].ncallees)
+      {
+        w = funcs[v].callees[next[v]++];
+        if (w == v)
+          recursive[funcs[v].decl->id] = TRUE;
+        if (funcs[w].index == 0)
+        {
+          funcs[w].index = funcs[w].low = ++count;
+          funcs[w].onStack = TRUE;
+          pending[nopen++] = w;
+          path[npath++] = w;
+        }
+        else if (funcs[w].onStack && funcs[w].index < funcs[v].low)
+          funcs[v].low = funcs[w].index;
+        continue;
+      }
+      npath--;
+      if (npath > 0 && funcs[v].low < funcs[path[npath - 1]].low)
+        funcs[path[npath - 1]].low = funcs[v].low;
+      if (funcs[v].low < funcs[v].index)
+        continue;
+      /* v leads the component pending[k..] */
+      for (k = nopen - 1; pending[k] != v; k--)
+        ;
+      several = k < nopen - 1;
+      while (nopen > k)
+      {
+        w = pending[--nopen];
+        funcs[w].onStack = FALSE;
+        if (several)
+          recursive[funcs[w].decl->id] = TRUE;
+      }
+    }
+  }
+  free(path);
+  free(next);
+  free(pending);
+}
+
+/* Function findRecursive returns, indexed by
+ * node id, whether each function declaration of
+ * tree can call itself
+ */
+char *findRecursive(TreeNode *tree)
+{
+  char *recursive;
+  buildCallGraph(tree);
+  recursive = (char *)calloc(funcOfSize, sizeof(char));
+  markRecursive(recursive);
+  freeCallGraph();
+  return recursive;
+}
@@ -0,0 +1,28 @@
+/****************************************************/
+/* File: callgraph.h                                */
+/* Call graph of the C-Minus compiler, used to      */
+/* drop functions unreachable from main and to      */
+/* find the recursive ones                          */
+/****************************************************/
+
+#ifndef _CALLGRAPH_H_
+#define _CALLGRAPH_H_
+
+/* Function dropUnreachable builds the call graph
+ * of the functions in *syntaxTree from the calls
+ * resolved by buildSymtab, and unlinks from the
+ * tree every function declaration that cannot be
+ * reached from main. It returns the number of
+ * functions dropped (none if there is no main)
+ */
+int dropUnreachable(TreeNode **syntaxTree);
+
+/* Function findRecursive returns an array of
+ * maxNodeId() + 1 flags, set at the id of every
+ * function declaration in tree that can call
+ * itself, directly or through other functions.
+ * The caller frees it
+ */
+char *findRecursive(TreeNode *tree);
+
+#endif
@@ -9,8 +9,13 @@
 
 #include "globals.h"
 #include "symtab.h"
+#include "util.h"
 #include "code.h"
+#include "peep.h"
 #include "cgen.h"
+#include "ir.h"
+#include "opt.h"
+#include "inline.h"
 
 /* tmpOffset is the memory offset for temps
    It is decremented each time a temp is
@@ -18,95 +23,559 @@
 */
 static int tmpOffset = 0;
 
-/* prototype for internal recursive code generator */
+/* visits counts the nodes cGen is called on */
+static long visits = 0;
+
+int RegAlloc = TRUE;
+int UseIR = FALSE;
+int DumpIR = FALSE;
+
+/* registers FIRSTREG .. FIRSTREG+NREGS-1 hold
+ * operands waiting for their right-hand side;
+ * regTop of them are in use. A register is only
+ * taken when no call comes before its use, so
+ * none is live across a call
+ */
+#define FIRSTREG 2
+#define NREGS 3
+static int regTop = 0;
+
+/* memSaved counts the temporary stores and
+ * loads avoided by keeping operands in registers
+ */
+static long memSaved = 0;
+
+/* entry[t->id] is the code location of
+ * function declaration t once generated, 0
+ * before
+ */
+static int *entry = NULL;
+
+/* the jumps of calls generated before the code
+ * of their function, patched by patchCalls
+ */
+typedef struct
+{
+   int loc;
+   TreeNode *decl;
+} PendingCall;
+
+static PendingCall *pending = NULL;
+static int npending = 0, pendingCap = 0;
+
+/* prototypes for internal recursive code generators */
 static void cGen(TreeNode *tree);
+static void genNode(TreeNode *tree);
+static char *genCond(TreeNode *tree);
+
+/* Function isGlobal tells whether variable l
+ * lives in the global area
+ */
+static int isGlobal(BucketList l)
+{
+   return l->scope->parent == preludeScope();
+}
+
+/* Function varOffset returns the offset of the
+ * first location of variable l from its base
+ * register
+ */
+int varOffset(BucketList l)
+{
+   if (isGlobal(l))
+      return l->memloc;
+   return -(FRAMEHDR + l->memloc + st_slots(l->treeNode) - 1);
+}
+
+/* Function varBase returns the base register of
+ * variable l, gp or fp
+ */
+int varBase(BucketList l)
+{
+   return isGlobal(l) ? gp : fp;
+}
+
+/* Procedure genBase loads the address of the
+ * first element of array l into register r;
+ * array parameters hold that address
+ */
+static void genBase(BucketList l, int r)
+{
+   TreeNode *d = l->treeNode;
+   if (d->nodekind == ExpK && d->kind.exp == ParamK)
+      emitRM("LD", r, varOffset(l), fp, "load array address");
+   else
+      emitRM("LDA", r, varOffset(l), varBase(l), "compute array address");
+}
+
+/* Function hasCall tells whether evaluating t
+ * calls a function of the program
+ */
+static int hasCall(TreeNode *t)
+{
+   int i;
+   for (; t != NULL; t = t->sibling)
+   {
+      if (t->nodekind == ExpK && t->kind.exp == CallK &&
+          t->symbol->scope != preludeScope())
+         return TRUE;
+      for (i = 0; i < MAXCHILDREN; i++)
+         if (hasCall(t->child[i]))
+            return TRUE;
+   }
+   return FALSE;
+}
+
+/* Function hasWrite tells whether evaluating t
+ * may change a variable: t assigns one or calls
+ * a function of the program
+ */
+static int hasWrite(TreeNode *t)
+{
+   int i;
+   for (; t != NULL; t = t->sibling)
+   {
+      if (t->nodekind == StmtK && t->kind.stmt == AssignK)
+         return TRUE;
+      if (t->nodekind == ExpK && t->kind.exp == CallK &&
+          t->symbol->scope != preludeScope())
+         return TRUE;
+      for (i = 0; i < MAXCHILDREN; i++)
+         if (hasWrite(t->child[i]))
+            return TRUE;
+   }
+   return FALSE;
+}
+
+/* Function isLeaf tells whether t is a constant
+ * or scalar variable, loaded by one instruction
+ */
+static int isLeaf(TreeNode *t)
+{
+   if (t->nodekind != ExpK)
+      return FALSE;
+   if (t->kind.exp == ConstK)
+      return TRUE;
+   return t->kind.exp == IdK && t->child[0] == NULL && t->symbol->type != IntegerArr;
+}
+
+/* Procedure genLeaf loads leaf t into register r */
+static void genLeaf(TreeNode *t, int r)
+{
+   BucketList l = t->symbol;
+   if (t->kind.exp == ConstK)
+      emitRM("LDC", r, t->attr.val, 0, "load const");
+   else
+      emitRM("LD", r, varOffset(l), varBase(l), "load id value");
+}
+
+/* Function frameSize returns the number of
+ * locations taken by the parameters and locals
+ * declared in t and its children
+ */
+static int frameSize(TreeNode *t)
+{
+   int size = 0, n, i;
+   for (; t != NULL; t = t->sibling)
+   {
+      if (t->symbol != NULL &&
+          ((t->nodekind == StmtK && t->kind.stmt == VarDeclK) ||
+           (t->nodekind == ExpK && t->kind.exp == ParamK)))
+      {
+         n = t->symbol->memloc + st_slots(t);
+         if (n > size)
+            size = n;
+      }
+      for (i = 0; i < MAXCHILDREN; i++)
+      {
+         n = frameSize(t->child[i]);
+         if (n > size)
+            size = n;
+      }
+   }
+   return size;
+}
+
+/* Function endsInReturn tells whether statement
+ * t always returns, so that no code is needed
+ * to leave it
+ */
+static int endsInReturn(TreeNode *t)
+{
+   if (t == NULL || t->nodekind != StmtK)
+      return FALSE;
+   switch (t->kind.stmt)
+   {
+   case ReturnK:
+      return TRUE;
+   case IfElseK:
+      return endsInReturn(t->child[1]) && endsInReturn(t->child[2]);
+   case CompK:
+      for (t = t->child[1]; t != NULL && t->sibling != NULL; t = t->sibling)
+         ;
+      return endsInReturn(t);
+   default:
+      return FALSE;
+   }
+}
+
+/* Function negJump returns the TM jump taken
+ * exactly when jump is not
+ */
+static char *negJump(char *jump)
+{
+   static char *pairs[] = {"JLT", "JGE", "JLE", "JGT", "JEQ", "JNE"};
+   int i;
+   for (i = 0; i < 6; i++)
+      if (strcmp(jump, pairs[i]) == 0)
+         return pairs[i ^ 1];
+   return jump;
+}
+
+/* Procedure genReturn returns from the current
+ * function, leaving the value in ac
+ */
+void genReturn(void)
+{
+   emitRM("LD", ac1, RETOFS, fp, "load return address");
+   emitRM("LD", fp, CTRLOFS, fp, "pop frame");
+   emitRM("LDA", pc, 0, ac1, "return");
+}
+
+/* Procedure genCall calls function declaration
+ * decl with its frame at offset frame from fp;
+ * the arguments must already be stored in it.
+ * The jump to a function not generated yet is
+ * left for patchCalls
+ */
+void genCall(int frame, TreeNode *decl)
+{
+   emitRM("ST", fp, frame + CTRLOFS, fp, "call: store control link");
+   emitRM("LDA", fp, frame, fp, "call: push frame");
+   emitRM("LDA", ac, 1, pc, "call: save return address");
+   if (entry[decl->id] != 0)
+   {
+      emitRM_Abs("LDA", pc, entry[decl->id], "call: jump to function");
+      return;
+   }
+   if (npending == pendingCap)
+   {
+      pendingCap = pendingCap ? 2 * pendingCap : 16;
+      pending = (PendingCall *)realloc(pending, pendingCap * sizeof(PendingCall));
+   }
+   pending[npending].loc = emitSkip(1);
+   pending[npending++].decl = decl;
+}
+
+/* Procedure patchCalls fills in the jumps left
+ * by genCall, once every function is generated
+ */
+static void patchCalls(void)
+{
+   int i;
+   for (i = 0; i < npending; i++)
+   {
+      emitBackup(pending[i].loc);
+      emitRM_Abs("LDA", pc, entry[pending[i].decl->id], "call: jump to function");
+   }
+   if (npending > 0)
+      emitRestore();
+   free(pending);
+   pending = NULL;
+   npending = pendingCap = 0;
+}
+
+/* Procedure genIR generates the body of function
+ * declaration t by way of the IR
+ */
+static void genIR(TreeNode *t)
+{
+   IrFunc *f = irBuild(t);
+   if (Optimize)
+      irOptimize(f);
+   if (DumpIR)
+   {
+      irPrint(listing, f);
+      fprintf(listing, "\n");
+   }
+   irEmit(f, tmpOffset);
+   irFree(f);
+}
 
 /* Procedure genStmt generates code at a statement node */
 static void genStmt(TreeNode *tree)
 {
    TreeNode *p1, *p2, *p3;
    int savedLoc1, savedLoc2, currentLoc;
-   int loc;
+   int params, locals, r;
+   char *jump;
+   BucketList l;
    switch (tree->kind.stmt)
    {
 
+   case FunDeclK:
+      if (TraceCode)
+         emitComment("-> function");
+      entry[tree->id] = emitSkip(0);
+      emitSymbol(tree->attr.name, tree->lineno);
+      emitRM("ST", ac, RETOFS, fp, "function: store return address");
+      /* temporaries start below the parameters and locals */
+      params = frameSize(tree->child[0]);
+      locals = frameSize(tree->child[1]);
+      tmpOffset = -(FRAMEHDR + (locals > params ? locals : params));
+      if (UseIR)
+         genIR(tree);
+      else
+         cGen(tree->child[1]);
+      genReturn();
+      if (TraceCode)
+         emitComment("<- function");
+      break; /* FunDeclK */
+
+   case CompK:
+      cGen(tree->child[1]);
+      break; /* CompK */
+
    case IfK:
+   case IfElseK:
       if (TraceCode)
          emitComment("-> if");
       p1 = tree->child[0];
       p2 = tree->child[1];
       p3 = tree->child[2];
       /* generate code for test expression */
-      cGen(p1);
+      jump = genCond(p1);
       savedLoc1 = emitSkip(1);
       emitComment("if: jump to else belongs here");
       /* recurse on then part */
       cGen(p2);
-      savedLoc2 = emitSkip(1);
-      emitComment("if: jump to end belongs here");
+      /* only an else part that can be reached
+       * from the then part needs jumping over
+       */
+      savedLoc2 = -1;
+      if (p3 != NULL && !endsInReturn(p2))
+      {
+         savedLoc2 = emitSkip(1);
+         emitComment("if: jump to end belongs here");
+      }
       currentLoc = emitSkip(0);
       emitBackup(savedLoc1);
-      emitRM_Abs("JEQ", ac, currentLoc, "if: jmp to else");
+      emitRM_Abs(negJump(jump), ac, currentLoc, "if: jmp to else");
       emitRestore();
       /* recurse on else part */
       cGen(p3);
-      currentLoc = emitSkip(0);
-      emitBackup(savedLoc2);
-      emitRM_Abs("LDA", pc, currentLoc, "jmp to end");
-      emitRestore();
+      if (savedLoc2 >= 0)
+      {
+         currentLoc = emitSkip(0);
+         emitBackup(savedLoc2);
+         emitRM_Abs("LDA", pc, currentLoc, "jmp to end");
+         emitRestore();
+      }
       if (TraceCode)
          emitComment("<- if");
       break; /* if_k */
 
-   // case RepeatK:
-   //    if (TraceCode)
-   //       emitComment("-> repeat");
-   //    p1 = tree->child[0];
-   //    p2 = tree->child[1];
-   //    savedLoc1 = emitSkip(0);
-   //    emitComment("repeat: jump after body comes back here");
-   //    /* generate code for body */
-   //    cGen(p1);
-   //    /* generate code for test */
-   //    cGen(p2);
-   //    emitRM_Abs("JEQ", ac, savedLoc1, "repeat: jmp back to body");
-   //    if (TraceCode)
-   //       emitComment("<- repeat");
-   //    break; /* repeat */
-
-   // case AssignK:
-   //    if (TraceCode)
-   //       emitComment("-> assign");
-   //    /* generate code for rhs */
-   //    cGen(tree->child[0]);
-   //    /* now store value */
-   //    loc = st_lookup(tree->attr.name);
-   //    emitRM("ST", ac, loc, gp, "assign: store value");
-   //    if (TraceCode)
-   //       emitComment("<- assign");
-   //    break; /* assign_k */
-
-   // case ReadK:
-   //    emitRO("IN", ac, 0, 0, "read integer value");
-   //    loc = st_lookup(tree->attr.name);
-   //    emitRM("ST", ac, loc, gp, "read: store value");
-   //    break;
-   // case WriteK:
-   //    /* generate code for expression to write */
-   //    cGen(tree->child[0]);
-   //    /* now output it */
-   //    emitRO("OUT", ac, 0, 0, "write ac");
-   //    break;
+   case WhileK:
+      if (TraceCode)
+         emitComment("-> while");
+      p1 = tree->child[0];
+      p2 = tree->child[1];
+      /* the test follows the body, so that each
+       * iteration takes a single jump
+       */
+      savedLoc1 = emitSkip(1);
+      emitComment("while: jump to test belongs here");
+      savedLoc2 = emitSkip(0);
+      emitComment("while: jump after test comes back here");
+      /* generate code for body */
+      cGen(p2);
+      currentLoc = emitSkip(0);
+      emitBackup(savedLoc1);
+      emitRM_Abs("LDA", pc, currentLoc, "while: jmp to test");
+      emitRestore();
+      /* generate code for test */
+      jump = genCond(p1);
+      emitRM_Abs(jump, ac, savedLoc2, "while: jmp back to body");
+      if (TraceCode)
+         emitComment("<- while");
+      break; /* WhileK */
+
+   case ReturnK:
+      if (TraceCode)
+         emitComment("-> return");
+      if (tree->child[0] != NULL)
+         genNode(tree->child[0]);
+      genReturn();
+      if (TraceCode)
+         emitComment("<- return");
+      break; /* ReturnK */
+
+   case AssignK:
+      if (TraceCode)
+         emitComment("-> assign");
+      p1 = tree->child[0];
+      p2 = tree->child[1];
+      l = p1->symbol;
+      if (p1->child[0] == NULL)
+      {
+         /* generate code for rhs */
+         genNode(p2);
+         /* now store value */
+         emitRM("ST", ac, varOffset(l), varBase(l), "assign: store value");
+      }
+      else
+      {
+         /* gen code for the element address */
+         genNode(p1->child[0]);
+         genBase(l, ac1);
+         if (RegAlloc && regTop < NREGS && !hasCall(p2))
+         {
+            /* keep the address in a register */
+            r = FIRSTREG + regTop++;
+            emitRO("ADD", r, ac1, ac, "assign: element address");
+            genNode(p2);
+            emitRM("ST", ac, 0, r, "assign: store value");
+            regTop--;
+            memSaved += 2;
+         }
+         else
+         {
+            emitRO("ADD", ac, ac1, ac, "assign: element address");
+            emitRM("ST", ac, tmpOffset--, fp, "assign: push address");
+            /* generate code for rhs */
+            genNode(p2);
+            emitRM("LD", ac1, ++tmpOffset, fp, "assign: load address");
+            emitRM("ST", ac, 0, ac1, "assign: store value");
+         }
+      }
+      if (TraceCode)
+         emitComment("<- assign");
+      break; /* assign_k */
+
    default:
       break;
    }
 } /* genStmt */
 
+/* Procedure genCompare sets ac to 1 if jump
+ * (the TM conditional jump of the relational
+ * operator) is taken on the difference of
+ * registers left and right, else to 0
+ */
+static void genCompare(char *jump, int left, int right, char *c)
+{
+   emitRO("SUB", ac, left, right, c);
+   emitRM(jump, ac, 2, pc, "br if true");
+   emitRM("LDC", ac, 0, ac, "false case");
+   emitRM("LDA", pc, 1, pc, "unconditional jmp");
+   emitRM("LDC", ac, 1, ac, "true case");
+}
+
+/* Procedure genOperands generates code for the
+ * operands of operator node tree and sets left
+ * and right to the registers holding them
+ */
+static void genOperands(TreeNode *tree, int *left, int *right)
+{
+   TreeNode *p1 = tree->child[0];
+   TreeNode *p2 = tree->child[1];
+   if (RegAlloc && isLeaf(p2))
+   {
+      /* ac = left, then ac1 = right */
+      genNode(p1);
+      genLeaf(p2, ac1);
+      *left = ac;
+      *right = ac1;
+      memSaved += 2;
+   }
+   else if (RegAlloc && isLeaf(p1) && (p1->kind.exp == ConstK || !hasWrite(p2)))
+   {
+      /* ac = right, then ac1 = left; the right
+       * operand cannot change the left
+       */
+      genNode(p2);
+      genLeaf(p1, ac1);
+      *left = ac1;
+      *right = ac;
+      memSaved += 2;
+   }
+   else if (RegAlloc && regTop < NREGS && !hasCall(p2))
+   {
+      /* keep the left operand in a register */
+      genNode(p1);
+      *left = FIRSTREG + regTop++;
+      emitRM("LDA", *left, 0, ac, "op: keep left");
+      genNode(p2);
+      regTop--;
+      *right = ac;
+      memSaved += 2;
+   }
+   else
+   {
+      /* gen code for ac = left arg */
+      genNode(p1);
+      /* gen code to push left operand */
+      emitRM("ST", ac, tmpOffset--, fp, "op: push left");
+      /* gen code for ac = right operand */
+      genNode(p2);
+      /* now load left operand */
+      emitRM("LD", ac1, ++tmpOffset, fp, "op: load left");
+      *left = ac1;
+      *right = ac;
+   }
+}
+
+/* Function genCond generates code for test
+ * tree and returns the TM jump taken on ac when
+ * the test holds. A relational operator leaves
+ * the difference of its operands in ac instead
+ * of a 0/1 value
+ */
+static char *genCond(TreeNode *tree)
+{
+   int left, right;
+   char *jump;
+   if (tree->nodekind != ExpK || tree->kind.exp != OpK)
+   {
+      genNode(tree);
+      return "JNE";
+   }
+   switch (tree->attr.op)
+   {
+   case LT:
+      jump = "JLT";
+      break;
+   case LE:
+      jump = "JLE";
+      break;
+   case GT:
+      jump = "JGT";
+      break;
+   case GE:
+      jump = "JGE";
+      break;
+   case EQ:
+      jump = "JEQ";
+      break;
+   case NE:
+      jump = "JNE";
+      break;
+   default:
+      genNode(tree);
+      return "JNE";
+   }
+   visits++;
+   genOperands(tree, &left, &right);
+   emitRO("SUB", ac, left, right, "test: compare");
+   return jump;
+}
+
 /* Procedure genExp generates code at an expression node */
 static void genExp(TreeNode *tree)
 {
-   int loc;
-   TreeNode *p1, *p2;
+   TreeNode *p1;
+   BucketList l;
+   int frame, n, left, right;
    switch (tree->kind.exp)
    {
 
@@ -119,55 +588,99 @@ static void genExp(TreeNode *tree)
          emitComment("<- Const");
       break; /* ConstK */
 
-      // case IdK:
-      //    if (TraceCode)
-      //       emitComment("-> Id");
-      //    loc = st_lookup(tree->attr.name);
-      //    emitRM("LD", ac, loc, gp, "load id value");
-      //    if (TraceCode)
-      //       emitComment("<- Id");
-      //    break; /* IdK */
+   case IdK:
+      if (TraceCode)
+         emitComment("-> Id");
+      l = tree->symbol;
+      if (tree->child[0] != NULL)
+      {
+         /* gen code for ac = index */
+         genNode(tree->child[0]);
+         genBase(l, ac1);
+         emitRO("ADD", ac, ac1, ac, "element address");
+         emitRM("LD", ac, 0, ac, "load element value");
+      }
+      else if (l->type == IntegerArr)
+         genBase(l, ac); /* arrays are passed by reference */
+      else
+         emitRM("LD", ac, varOffset(l), varBase(l), "load id value");
+      if (TraceCode)
+         emitComment("<- Id");
+      break; /* IdK */
+
+   case CallK:
+      if (TraceCode)
+         emitComment("-> Call");
+      l = tree->symbol;
+      if (l->scope == preludeScope())
+      {
+         /* the built-ins are single instructions */
+         if (strcmp(l->name, "input") == 0)
+            emitRO("IN", ac, 0, 0, "read integer value");
+         else
+         {
+            genNode(tree->child[0]);
+            emitRO("OUT", ac, 0, 0, "write ac");
+         }
+      }
+      else
+      {
+         /* the new frame starts at the first free
+          * temporary; its arguments are stored in
+          * place, with the temporaries they need
+          * below them
+          */
+         frame = tmpOffset;
+         for (n = 0, p1 = tree->child[0]; p1 != NULL; p1 = p1->sibling)
+            n++;
+         tmpOffset = frame - FRAMEHDR - n;
+         for (n = 0, p1 = tree->child[0]; p1 != NULL; p1 = p1->sibling, n++)
+         {
+            genNode(p1);
+            emitRM("ST", ac, frame - FRAMEHDR - n, fp, "call: store argument");
+         }
+         tmpOffset = frame;
+         genCall(frame, l->treeNode);
+      }
+      if (TraceCode)
+         emitComment("<- Call");
+      break; /* CallK */
 
    case OpK:
       if (TraceCode)
          emitComment("-> Op");
-      p1 = tree->child[0];
-      p2 = tree->child[1];
-      /* gen code for ac = left arg */
-      cGen(p1);
-      /* gen code to push left operand */
-      emitRM("ST", ac, tmpOffset--, mp, "op: push left");
-      /* gen code for ac = right operand */
-      cGen(p2);
-      /* now load left operand */
-      emitRM("LD", ac1, ++tmpOffset, mp, "op: load left");
+      genOperands(tree, &left, &right);
       switch (tree->attr.op)
       {
       case PLUS:
-         emitRO("ADD", ac, ac1, ac, "op +");
+         emitRO("ADD", ac, left, right, "op +");
          break;
       case MINUS:
-         emitRO("SUB", ac, ac1, ac, "op -");
+         emitRO("SUB", ac, left, right, "op -");
          break;
       case TIMES:
-         emitRO("MUL", ac, ac1, ac, "op *");
+         emitRO("MUL", ac, left, right, "op *");
          break;
       case OVER:
-         emitRO("DIV", ac, ac1, ac, "op /");
+         emitRO("DIV", ac, left, right, "op /");
          break;
       case LT:
-         emitRO("SUB", ac, ac1, ac, "op <");
-         emitRM("JLT", ac, 2, pc, "br if true");
-         emitRM("LDC", ac, 0, ac, "false case");
-         emitRM("LDA", pc, 1, pc, "unconditional jmp");
-         emitRM("LDC", ac, 1, ac, "true case");
+         genCompare("JLT", left, right, "op <");
+         break;
+      case LE:
+         genCompare("JLE", left, right, "op <=");
+         break;
+      case GT:
+         genCompare("JGT", left, right, "op >");
+         break;
+      case GE:
+         genCompare("JGE", left, right, "op >=");
          break;
       case EQ:
-         emitRO("SUB", ac, ac1, ac, "op ==");
-         emitRM("JEQ", ac, 2, pc, "br if true");
-         emitRM("LDC", ac, 0, ac, "false case");
-         emitRM("LDA", pc, 1, pc, "unconditional jmp");
-         emitRM("LDC", ac, 1, ac, "true case");
+         genCompare("JEQ", left, right, "op ==");
+         break;
+      case NE:
+         genCompare("JNE", left, right, "op !=");
          break;
       default:
          emitComment("BUG: Unknown operator");
@@ -182,13 +695,14 @@ static void genExp(TreeNode *tree)
    }
 } /* genExp */
 
-/* Procedure cGen recursively generates code by
- * tree traversal
+/* Procedure genNode generates code for a single
+ * node, without its siblings
  */
-static void cGen(TreeNode *tree)
+static void genNode(TreeNode *tree)
 {
    if (tree != NULL)
    {
+      visits++;
       switch (tree->nodekind)
       {
       case StmtK:
@@ -200,10 +714,35 @@ static void cGen(TreeNode *tree)
       default:
          break;
       }
-      cGen(tree->sibling);
    }
 }
 
+/* Procedure cGen recursively generates code by
+ * tree traversal
+ */
+static void cGen(TreeNode *tree)
+{
+   for (; tree != NULL; tree = tree->sibling)
+      genNode(tree);
+}
+
+/* Function codeGenVisits returns the number of
+ * nodes visited by the code generator so far
+ */
+long codeGenVisits(void)
+{
+   return visits;
+}
+
+/* Function codeGenMemSaved returns the number
+ * of temporary stores and loads avoided so far
+ * by keeping operands in registers
+ */
+long codeGenMemSaved(void)
+{
+   return memSaved;
+}
+
 /**********************************************/
 /* the primary function of the code generator */
 /**********************************************/
@@ -216,8 +755,12 @@ static void cGen(TreeNode *tree)
 void codeGen(TreeNode *syntaxTree, char *codefile)
 {
    char *s = malloc(strlen(codefile) + 7);
+   TreeNode *t, *mainDecl = NULL;
+   int savedLoc, currentLoc;
    strcpy(s, "File: ");
    strcat(s, codefile);
+   entry = (int *)calloc(maxNodeId() + 1, sizeof(int));
+   regTop = 0;
    emitComment("TINY Compilation to TM Code");
    emitComment(s);
    /* generate standard prelude */
@@ -225,9 +768,34 @@ void codeGen(TreeNode *syntaxTree, char *codefile)
    emitRM("LD", mp, 0, ac, "load maxaddress from location 0");
    emitRM("ST", ac, 0, ac, "clear location 0");
    emitComment("End of standard prelude.");
-   /* generate code for TINY program */
+   savedLoc = emitSkip(1);
+   emitComment("jump around the functions belongs here");
+   if (Optimize && Inline)
+      planInlining(syntaxTree);
+   /* generate code for C-Minus program */
    cGen(syntaxTree);
+   currentLoc = emitSkip(0);
+   emitBackup(savedLoc);
+   emitRM_Abs("LDA", pc, currentLoc, "jump around the functions");
+   emitRestore();
+   /* call main with its frame at the top of memory */
+   for (t = syntaxTree; t != NULL; t = t->sibling)
+      if (t->nodekind == StmtK && t->kind.stmt == FunDeclK &&
+          strcmp(t->attr.name, "main") == 0)
+         mainDecl = t;
+   if (mainDecl != NULL)
+   {
+      tmpOffset = 0;
+      genCall(tmpOffset, mainDecl);
+   }
+   patchCalls();
    /* finish */
    emitComment("End of execution.");
    emitRO("HALT", 0, 0, 0, "");
+   if (Peephole)
+      peephole();
+   emitFlush(code);
+   endInlining();
+   free(entry);
+   entry = NULL;
 }
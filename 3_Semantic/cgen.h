@@ -16,4 +16,66 @@
  */
 void codeGen(TreeNode *syntaxTree, char *codefile);
 
+/* Function codeGenVisits returns the number of
+ * nodes visited by the code generator so far
+ */
+long codeGenVisits(void);
+
+/* RegAlloc = TRUE lets the code generator keep
+ * temporaries in the registers between ac1 and
+ * gp instead of the temporary area of the frame
+ */
+extern int RegAlloc;
+
+/* Function codeGenMemSaved returns the number
+ * of temporary stores and loads avoided so far
+ * by keeping operands in registers
+ */
+long codeGenMemSaved(void);
+
+/* UseIR = TRUE makes the code generator lower
+ * each function to the three-address IR of ir.h
+ * and generate its code from there
+ */
+extern int UseIR;
+
+/* DumpIR = TRUE prints the IR of each function
+ * to the listing file
+ */
+extern int DumpIR;
+
+/* An activation record starts at fp and grows
+ * toward lower addresses:
+ *     0(fp)   control link (the caller's fp)
+ *    -1(fp)   return address
+ *    -2(fp)   parameters and locals, by memloc
+ * followed by the temporaries. Globals are
+ * addressed upward from gp
+ */
+#define CTRLOFS 0
+#define RETOFS -1
+#define FRAMEHDR 2
+
+/* Function varOffset returns the offset of the
+ * first location of variable l from its base
+ * register
+ */
+int varOffset(BucketList l);
+
+/* Function varBase returns the base register of
+ * variable l, gp or fp
+ */
+int varBase(BucketList l);
+
+/* Procedure genCall calls function declaration
+ * decl with its frame at offset frame from fp;
+ * the arguments must already be stored in it
+ */
+void genCall(int frame, TreeNode *decl);
+
+/* Procedure genReturn returns from the current
+ * function, leaving the value in ac
+ */
+void genReturn(void);
+
 #endif
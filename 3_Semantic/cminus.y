@@ -15,7 +15,9 @@
 #define YYSTYPE TreeNode *
 static char * savedName; /* for use in assignments */
 static int savedLineNo;  /* ditto */
+static int savedColNo;   /* ditto */
 static int savedNum;
+static int savedNumColNo;
 static TreeNode * savedTree; /* stores syntax tree for later return */
 static int yylex(void); // added 11/2/11 to ensure no conflict with lex
 static int yyerror(char *s);
@@ -53,27 +55,32 @@ saveName :  ID
             { 
               savedName = copyString(tokenString);
               savedLineNo = lineno;
+              savedColNo = colno;
             }
             ;
 saveNumber :  NUM
               { 
                 savedNum = atoi(tokenString);
                 savedLineNo = lineno;
+                savedNumColNo = colno;
               }
               ;
 var_declaration : type_specifier saveName SEMI
                   {
                     $$ = newStmtNode(VarDeclK);
                     $$->attr.name = savedName;
+                    $$->colno = savedColNo;
                     $$->type = $1->type;
                   }
                 | type_specifier saveName LBRACE saveNumber RBRACE SEMI
                   {
                     $$ = newStmtNode(VarDeclK);
                     $$->attr.name = savedName;
+                    $$->colno = savedColNo;
                     $$->type = $1->type + 2;
                     $$->child[0] = newExpNode(ConstK);
                     $$->child[0]->attr.val = savedNum;
+                    $$->child[0]->colno = savedNumColNo;
                   }
                   ;
 type_specifier :  INT
@@ -91,6 +98,7 @@ fun_declaration	: type_specifier saveName
                  	{ 
                     $$ = newStmtNode(FunDeclK);
                     $$->attr.name = savedName;
+                    $$->colno = savedColNo;
                     $$->type = $1->type;
                  	}
                   LPAREN params RPAREN compound_stmt
@@ -120,12 +128,14 @@ param : type_specifier saveName
         { 
           $$ = newExpNode(ParamK);
           $$->attr.name = savedName;
+          $$->colno = savedColNo;
           $$->type = $1->type;
         }
       | type_specifier saveName LBRACE RBRACE
         {
           $$ = newExpNode(ParamK);
           $$->attr.name = savedName;
+          $$->colno = savedColNo;
           $$->type = $1->type + 2;
         }
         ;
@@ -170,12 +180,14 @@ expression_stmt : expression SEMI { $$ = $1; }
 selection_stmt :  IF LPAREN expression RPAREN statement %prec NO_ELSE
                  	{
                     $$ = newStmtNode(IfK);
+                    $$->colno = $3->colno;
                     $$->child[0] = $3;
                     $$->child[1] = $5;
                     $$->child[2] = NULL;
                  	}
             	  | IF LPAREN expression RPAREN statement ELSE statement
                  	{ $$ = newStmtNode(IfElseK);
+                 	  $$->colno = $3->colno;
                  	  $$->child[0] = $3;
                  	  $$->child[1] = $5;
                  	  $$->child[2] = $7;
@@ -184,24 +196,29 @@ selection_stmt :  IF LPAREN expression RPAREN statement %prec NO_ELSE
 iteration_stmt : WHILE LPAREN expression RPAREN statement
                  	{
                     $$ = newStmtNode(WhileK);
+                    $$->colno = $3->colno;
                     $$->child[0] = $3;
                     $$->child[1] = $5;
                  	}
             	     ;
-return_stmt : RETURN SEMI
+return_stmt : saveReturn SEMI
               { 
-                $$ = newStmtNode(ReturnK);
+                $$ = $1;
                 $$->child[0] = NULL;
               }
-            | RETURN expression SEMI
+            | saveReturn expression SEMI
               { 
-                $$ = newStmtNode(ReturnK);
+                $$ = $1;
                 $$->child[0] = $2;
               }
               ;
+saveReturn : RETURN
+             { $$ = newStmtNode(ReturnK); }
+             ;
 expression :  var ASSIGN expression
               {
                 $$ = newStmtNode(AssignK);
+                $$->colno = $1->colno;
                 $$->child[0] = $1;
                 $$->child[1] = $3;
               }
@@ -211,11 +228,13 @@ var         : saveName
               { 
                 $$ = newExpNode(IdK);
                 $$->attr.name = savedName;
+                $$->colno = savedColNo;
               }
             | saveName
               { 
                 $$ = newExpNode(IdK);
                 $$->attr.name = savedName;
+                $$->colno = savedColNo;
               }
               LBRACE expression RBRACE
               { 
@@ -301,12 +320,14 @@ factor :        LPAREN expression RPAREN { $$ = $2; }
                 { 
                   $$ = newExpNode(ConstK);
                   $$->attr.val = savedNum;
+                  $$->colno = savedNumColNo;
                 }
             	  ;
 call :            saveName
                  	{ 
                     $$ = newExpNode(CallK);
                 	  $$->attr.name = savedName;
+                	  $$->colno = savedColNo;
                  	}
               	  LPAREN args RPAREN
                  	{ 
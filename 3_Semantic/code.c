@@ -8,6 +8,9 @@
 
 #include "globals.h"
 #include "code.h"
+#include "tmb.h"
+
+CodeFormat CodeMode = TextCode;
 
 /* TM location number for current instruction emission */
 static int emitLoc = 0;
@@ -17,13 +20,105 @@ static int emitLoc = 0;
    emitBackup, and emitRestore */
 static int highEmitLoc = 0;
 
+/* the code buffer: buffer[loc] is the
+ * instruction at TM location loc
+ */
+static TMInstr *buffer = NULL;
+static int bufferCap = 0;
+
+/* comments, with the location they precede and
+ * their place in the order of emission
+ */
+typedef struct
+{
+  int loc;
+  int seq;
+  char *text;
+} CodeComment;
+
+static CodeComment *comments = NULL;
+static int commentCount = 0;
+static int commentCap = 0;
+
+/* named locations for binary code files */
+typedef struct
+{
+  int loc;
+  int lineno;
+  char *name;
+} CodeSymbol;
+
+static CodeSymbol *symbols = NULL;
+static int symbolCount = 0;
+static int symbolCap = 0;
+
+static char *opNames[] = {
+    "HALT", "IN", "OUT", "ADD", "SUB", "MUL", "DIV", "????",
+    "LD", "ST", "????",
+    "LDA", "LDC", "JLT", "JLE", "JGT", "JGE", "JEQ", "JNE", "????"};
+
+/* Function opcode returns the TMOpcode named op */
+static int opcode(char *op)
+{
+  int i;
+  for (i = 0; i < opRALim; i++)
+    if (strcmp(op, opNames[i]) == 0)
+      return i;
+  return opRALim; /* prints as ???? */
+}
+
+/* Function slot returns the buffer entry for
+ * the current location and advances it
+ */
+static TMInstr *slot(void)
+{
+  TMInstr *in;
+  if (emitLoc >= bufferCap)
+  {
+    int cap = bufferCap ? 2 * bufferCap : 1024;
+    while (cap <= emitLoc)
+      cap *= 2;
+    buffer = (TMInstr *)realloc(buffer, cap * sizeof(TMInstr));
+    for (; bufferCap < cap; bufferCap++)
+      buffer[bufferCap].op = -1;
+  }
+  in = &buffer[emitLoc++];
+  if (highEmitLoc < emitLoc)
+    highEmitLoc = emitLoc;
+  return in;
+}
+
 /* Procedure emitComment prints a comment line
  * with comment c in the code file
  */
 void emitComment(char *c)
 {
   if (TraceCode)
-    fprintf(code, "* %s\n", c);
+  {
+    if (commentCount == commentCap)
+    {
+      commentCap = commentCap ? 2 * commentCap : 256;
+      comments = (CodeComment *)realloc(comments, commentCap * sizeof(CodeComment));
+    }
+    comments[commentCount].loc = emitLoc;
+    comments[commentCount].seq = commentCount;
+    comments[commentCount++].text = c;
+  }
+}
+
+/* Procedure emitSymbol names the current code
+ * location in binary code files
+ */
+void emitSymbol(char *name, int lineno)
+{
+  if (symbolCount == symbolCap)
+  {
+    symbolCap = symbolCap ? 2 * symbolCap : 64;
+    symbols = (CodeSymbol *)realloc(symbols, symbolCap * sizeof(CodeSymbol));
+  }
+  symbols[symbolCount].loc = emitLoc;
+  symbols[symbolCount].lineno = lineno;
+  symbols[symbolCount++].name = name;
 }
 
 /* Procedure emitRO emits a register-only
@@ -36,12 +131,13 @@ void emitComment(char *c)
  */
 void emitRO(char *op, int r, int s, int t, char *c)
 {
-  fprintf(code, "%3d:  %5s  %d,%d,%d ", emitLoc++, op, r, s, t);
-  if (TraceCode)
-    fprintf(code, "\t%s", c);
-  fprintf(code, "\n");
-  if (highEmitLoc < emitLoc)
-    highEmitLoc = emitLoc;
+  TMInstr *in = slot();
+  in->op = opcode(op);
+  in->r = r;
+  in->s = s;
+  in->t = t;
+  in->d = 0;
+  in->comment = c;
 } /* emitRO */
 
 /* Procedure emitRM emits a register-to-memory
@@ -54,12 +150,13 @@ void emitRO(char *op, int r, int s, int t, char *c)
  */
 void emitRM(char *op, int r, int d, int s, char *c)
 {
-  fprintf(code, "%3d:  %5s  %d,%d(%d) ", emitLoc++, op, r, d, s);
-  if (TraceCode)
-    fprintf(code, "\t%s", c);
-  fprintf(code, "\n");
-  if (highEmitLoc < emitLoc)
-    highEmitLoc = emitLoc;
+  TMInstr *in = slot();
+  in->op = opcode(op);
+  in->r = r;
+  in->s = s;
+  in->t = 0;
+  in->d = d;
+  in->comment = c;
 } /* emitRM */
 
 /* Function emitSkip skips "howMany" code
@@ -104,12 +201,226 @@ void emitRestore(void)
  */
 void emitRM_Abs(char *op, int r, int a, char *c)
 {
-  fprintf(code, "%3d:  %5s  %d,%d(%d) ",
-          emitLoc, op, r, a - (emitLoc + 1), pc);
-  ++emitLoc;
-  if (TraceCode)
-    fprintf(code, "\t%s", c);
-  fprintf(code, "\n");
-  if (highEmitLoc < emitLoc)
-    highEmitLoc = emitLoc;
+  emitRM(op, r, a - (emitLoc + 1), pc, c);
 } /* emitRM_Abs */
+
+/* Function emitCode returns the code buffer and
+ * sets *size to the number of locations emitted
+ */
+TMInstr *emitCode(int *size)
+{
+  *size = highEmitLoc;
+  return buffer;
+}
+
+/* Procedure emitCompact removes the locations
+ * marked in dead from the code buffer
+ */
+void emitCompact(char *dead)
+{
+  int *newLoc = (int *)malloc((highEmitLoc + 1) * sizeof(int));
+  int loc, n = 0, target;
+  for (loc = 0; loc < highEmitLoc; loc++)
+  {
+    newLoc[loc] = n;
+    if (!dead[loc])
+      n++;
+  }
+  newLoc[highEmitLoc] = n;
+  for (loc = 0; loc < highEmitLoc; loc++)
+  {
+    TMInstr *in = &buffer[loc];
+    if (dead[loc])
+      continue;
+    if (in->op > opRRLim && in->s == pc)
+    {
+      target = loc + 1 + in->d;
+      if (target >= 0 && target <= highEmitLoc)
+        in->d = newLoc[target] - (newLoc[loc] + 1);
+    }
+    buffer[newLoc[loc]] = *in;
+  }
+  for (loc = n; loc < highEmitLoc; loc++)
+    buffer[loc].op = -1;
+  for (loc = 0; loc < commentCount; loc++)
+    comments[loc].loc = newLoc[comments[loc].loc];
+  for (loc = 0; loc < symbolCount; loc++)
+    symbols[loc].loc = newLoc[symbols[loc].loc];
+  emitLoc = highEmitLoc = n;
+  free(newLoc);
+}
+
+/* the output buffer of emitFlush */
+#define OUTSIZE 65536
+static char outBuf[OUTSIZE];
+static int outLen = 0;
+static FILE *outFile;
+
+/* outChars appends n characters of s to outBuf,
+ * writing a string longer than outBuf directly
+ */
+static void outChars(const char *s, int n)
+{
+  if (outLen + n > OUTSIZE)
+  {
+    fwrite(outBuf, 1, outLen, outFile);
+    outLen = 0;
+  }
+  if (n > OUTSIZE)
+  {
+    fwrite(s, 1, n, outFile);
+    return;
+  }
+  memcpy(outBuf + outLen, s, n);
+  outLen += n;
+}
+
+static void outStr(const char *s)
+{
+  outChars(s, strlen(s));
+}
+
+/* outInt prints v right-justified in width */
+static void outInt(int v, int width)
+{
+  char digits[16];
+  char *p = digits + sizeof(digits);
+  unsigned u = v < 0 ? -(unsigned)v : (unsigned)v;
+  int n;
+  do
+  {
+    *--p = '0' + u % 10;
+    u /= 10;
+  } while (u != 0);
+  if (v < 0)
+    *--p = '-';
+  n = digits + sizeof(digits) - p;
+  for (; width > n; width--)
+    outChars(" ", 1);
+  outChars(p, n);
+}
+
+/* byLoc orders comments by location, keeping
+ * the order of emission among equals
+ */
+static int byLoc(const void *a, const void *b)
+{
+  const CodeComment *x = (const CodeComment *)a, *y = (const CodeComment *)b;
+  if (x->loc != y->loc)
+    return x->loc - y->loc;
+  return x->seq - y->seq;
+}
+
+/* Procedure writeBinary writes the code buffer
+ * to outFile in the .tmb format
+ */
+static void writeBinary(void)
+{
+  TMBHeader h;
+  TMBInstr bin;
+  TMBSymbol sym;
+  int i, strSize = 0;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, TMB_MAGIC, 4);
+  h.byteOrder = TMB_ORDER;
+  h.ninstr = highEmitLoc;
+  h.nsyms = symbolCount;
+  for (i = 0; i < symbolCount; i++)
+    strSize += strlen(symbols[i].name) + 1;
+  h.strSize = strSize;
+  outChars((char *)&h, sizeof(h));
+  for (i = 0; i < highEmitLoc; i++)
+  {
+    TMInstr *in = &buffer[i];
+    memset(&bin, 0, sizeof(bin));
+    if (in->op >= 0) /* unfilled locations halt */
+    {
+      bin.op = in->op;
+      bin.r = in->r;
+      bin.s = in->s;
+      bin.t = in->t;
+      bin.d = in->d;
+    }
+    outChars((char *)&bin, sizeof(bin));
+  }
+  for (strSize = 0, i = 0; i < symbolCount; i++)
+  {
+    sym.loc = symbols[i].loc;
+    sym.lineno = symbols[i].lineno;
+    sym.name = strSize;
+    strSize += strlen(symbols[i].name) + 1;
+    outChars((char *)&sym, sizeof(sym));
+  }
+  for (i = 0; i < symbolCount; i++)
+    outChars(symbols[i].name, strlen(symbols[i].name) + 1);
+}
+
+/* Procedure writeText writes the code buffer to
+ * outFile as TM text
+ */
+static void writeText(void)
+{
+  TMInstr *in;
+  int loc, c = 0, n;
+  qsort(comments, commentCount, sizeof(CodeComment), byLoc);
+  for (loc = 0; loc <= highEmitLoc; loc++)
+  {
+    for (; c < commentCount && comments[c].loc == loc; c++)
+    {
+      outStr("* ");
+      outStr(comments[c].text);
+      outChars("\n", 1);
+    }
+    if (loc == highEmitLoc || buffer[loc].op < 0)
+      continue;
+    in = &buffer[loc];
+    outInt(loc, 3);
+    outStr(":  ");
+    n = strlen(opNames[in->op]);
+    for (; n < 5; n++)
+      outChars(" ", 1);
+    outStr(opNames[in->op]);
+    outStr("  ");
+    outInt(in->r, 0);
+    outChars(",", 1);
+    if (in->op < opRRLim)
+    {
+      outInt(in->s, 0);
+      outChars(",", 1);
+      outInt(in->t, 0);
+    }
+    else
+    {
+      outInt(in->d, 0);
+      outChars("(", 1);
+      outInt(in->s, 0);
+      outChars(")", 1);
+    }
+    outChars(" ", 1);
+    if (TraceCode)
+    {
+      outChars("\t", 1);
+      outStr(in->comment);
+    }
+    outChars("\n", 1);
+  }
+}
+
+/* Procedure emitFlush writes the code buffer to
+ * out in location order and empties it
+ */
+void emitFlush(FILE *out)
+{
+  int loc;
+  outFile = out;
+  if (CodeMode == BinaryCode)
+    writeBinary();
+  else
+    writeText();
+  fwrite(outBuf, 1, outLen, outFile);
+  outLen = 0;
+  emitLoc = highEmitLoc = 0;
+  commentCount = symbolCount = 0;
+  for (loc = 0; loc < bufferCap; loc++)
+    buffer[loc].op = -1;
+}
@@ -17,6 +17,12 @@
  */
 #define mp 6
 
+/* fp = "frame pointer" points to the
+ * activation record of the current function;
+ * mp takes this role once main is called
+ */
+#define fp mp
+
 /* gp = "global pointer" points
  * to bottom of memory for (global)
  * variable storage
@@ -29,6 +35,58 @@
 /* 2nd accumulator */
 #define ac1 1
 
+/* the TM opcodes, in the order of the
+ * simulator's opcode table
+ */
+typedef enum
+{
+   /* RO instructions */
+   opHALT,
+   opIN,
+   opOUT,
+   opADD,
+   opSUB,
+   opMUL,
+   opDIV,
+   opRRLim,
+   /* RM instructions */
+   opLD,
+   opST,
+   opRMLim,
+   /* RA instructions */
+   opLDA,
+   opLDC,
+   opJLT,
+   opJLE,
+   opJGT,
+   opJGE,
+   opJEQ,
+   opJNE,
+   opRALim
+} TMOpcode;
+
+/* an instruction in the code buffer; locations
+ * skipped and never filled have op < 0
+ */
+typedef struct
+{
+   short op;
+   unsigned char r, s, t; /* RO: r,s,t; RM/RA: r and base register s */
+   int d;                 /* RM/RA: offset */
+   char *comment;
+} TMInstr;
+
+/* output formats of emitFlush: TM text, or
+ * the binary format of tmb.h
+ */
+typedef enum
+{
+   TextCode,
+   BinaryCode
+} CodeFormat;
+
+extern CodeFormat CodeMode;
+
 /* code emitting utilities */
 
 /* Procedure emitComment prints a comment line
@@ -83,4 +141,31 @@ void emitRestore(void);
  */
 void emitRM_Abs(char *op, int r, int a, char *c);
 
+/* Procedure emitSymbol names the current code
+ * location, the entry of a function declared at
+ * line lineno, in binary code files
+ */
+void emitSymbol(char *name, int lineno);
+
+/* Function emitCode returns the code buffer and
+ * sets *size to the number of locations emitted
+ * so far, for passes over the generated code
+ */
+TMInstr *emitCode(int *size);
+
+/* Procedure emitCompact removes from the code
+ * buffer every location loc with dead[loc] set;
+ * comments and symbols move with the code, and
+ * pc-relative offsets are adjusted so that each
+ * still reaches its instruction, or the next one
+ * kept if it was removed
+ */
+void emitCompact(char *dead);
+
+/* Procedure emitFlush writes the instructions
+ * emitted so far to out in CodeMode, in
+ * location order, and empties the code buffer
+ */
+void emitFlush(FILE *out);
+
 #endif
@@ -0,0 +1,246 @@
+/****************************************************/
+/* File: diag.c                                     */
+/* Diagnostic buffer implementation for the         */
+/* C-Minus compiler                                 */
+/****************************************************/
+
+#include "globals.h"
+#include "diag.h"
+
+DiagFormat DiagMode = DiagText;
+int MaxErrors = 0;
+
+static DiagBuffer mainBuf = {NULL, 0, 0};
+static _Thread_local DiagBuffer *current = NULL;
+
+static void push(DiagBuffer *buf, Diagnostic *d)
+{
+  if (buf->count == buf->cap)
+  {
+    buf->cap = buf->cap ? 2 * buf->cap : 16;
+    buf->items = (Diagnostic *)realloc(buf->items, buf->cap * sizeof(Diagnostic));
+  }
+  buf->items[buf->count++] = *d;
+}
+
+/* Procedure diagReport records a diagnostic in
+ * the calling thread's buffer
+ */
+void diagReport(ErrorKind kind, char *name, int lineno, int colno)
+{
+  Diagnostic d;
+  d.kind = kind;
+  d.lineno = lineno;
+  d.colno = colno;
+  d.name = name;
+  push(current != NULL ? current : &mainBuf, &d);
+}
+
+/* Function diagSetBuffer makes buf the calling
+ * thread's buffer and returns the previous one
+ */
+DiagBuffer *diagSetBuffer(DiagBuffer *buf)
+{
+  DiagBuffer *prev = current;
+  current = buf;
+  return prev;
+}
+
+/* Procedure diagAppend moves the contents of
+ * buf to the end of the main buffer
+ */
+void diagAppend(DiagBuffer *buf)
+{
+  int i;
+  for (i = 0; i < buf->count; i++)
+    push(&mainBuf, &buf->items[i]);
+  free(buf->items);
+  buf->items = NULL;
+  buf->count = buf->cap = 0;
+}
+
+static const char *kindName(ErrorKind kind)
+{
+  switch (kind)
+  {
+  case UndecFunc:
+    return "UndecFunc";
+  case UndecVar:
+    return "UndecVar";
+  case RedefSym:
+    return "RedefSym";
+  case VoidVar:
+    return "VoidVar";
+  case NoIntIdx:
+    return "NoIntIdx";
+  case NoArrIdx:
+    return "NoArrIdx";
+  case InvalCall:
+    return "InvalCall";
+  case InvalReturn:
+    return "InvalReturn";
+  case InvalAssign:
+    return "InvalAssign";
+  case InvalOper:
+    return "InvalOper";
+  case InvalCond:
+    return "InvalCond";
+  case DivZero:
+    return "DivZero";
+  case IdxRange:
+    return "IdxRange";
+  default:
+    return "Unknown";
+  }
+}
+
+/* Procedure formatMessage formats the text of
+ * diagnostic d (without a newline) into buf
+ */
+static void formatMessage(char *buf, int size, Diagnostic *d)
+{
+  char *name = d->name;
+  int lineno = d->lineno;
+  switch (d->kind)
+  {
+  case UndecFunc:
+    snprintf(buf, size, "Error: undeclared function \"%s\" is called at line %d", name, lineno);
+    break;
+  case UndecVar:
+    snprintf(buf, size, "Error: undeclared variable \"%s\" is used at line %d", name, lineno);
+    break;
+  case RedefSym:
+    snprintf(buf, size, "Error: Symbol \"%s\" is redefined at line %d", name, lineno);
+    break;
+  case VoidVar:
+    snprintf(buf, size, "Error: The void-type variable is declared at line %d (name : \"%s\")", lineno, name);
+    break;
+  case NoIntIdx:
+    snprintf(buf, size, "Error: Invalid array indexing at line %d (name : \"%s\"). indicies should be integer", lineno, name);
+    break;
+  case NoArrIdx:
+    snprintf(buf, size, "Error: Invalid array indexing at line %d (name : \"%s\"). indexing can only allowed for int[] variables", lineno, name);
+    break;
+  case InvalCall:
+    snprintf(buf, size, "Error: Invalid function call at line %d (name : \"%s\")", lineno, name);
+    break;
+  case InvalReturn:
+    snprintf(buf, size, "Error: Invalid return at line %d", lineno);
+    break;
+  case InvalAssign:
+    snprintf(buf, size, "Error: invalid assignment at line %d", lineno);
+    break;
+  case InvalOper:
+    snprintf(buf, size, "Error: invalid operation at line %d", lineno);
+    break;
+  case InvalCond:
+    snprintf(buf, size, "Error: invalid condition at line %d", lineno);
+    break;
+  case DivZero:
+    snprintf(buf, size, "Error: division by zero at line %d", lineno);
+    break;
+  case IdxRange:
+    snprintf(buf, size, "Error: Invalid array indexing at line %d (name : \"%s\"). index is out of bounds", lineno, name);
+    break;
+  default:
+    snprintf(buf, size, "Error at line %d", lineno);
+    break;
+  }
+}
+
+/* printJSONString prints s as a JSON string */
+static void printJSONString(FILE *out, const char *s)
+{
+  fputc('"', out);
+  for (; *s != '\0'; s++)
+  {
+    if (*s == '"' || *s == '\\')
+      fputc('\\', out);
+    fputc(*s, out);
+  }
+  fputc('"', out);
+}
+
+/* order sorts diagnostics by position and
+ * keeps the report order among equals
+ */
+static Diagnostic *sortItems;
+
+static int order(const void *a, const void *b)
+{
+  int i = *(const int *)a, j = *(const int *)b;
+  Diagnostic *x = &sortItems[i], *y = &sortItems[j];
+  if (x->lineno != y->lineno)
+    return x->lineno - y->lineno;
+  if (x->colno != y->colno)
+    return x->colno - y->colno;
+  return i - j;
+}
+
+static int same(Diagnostic *x, Diagnostic *y)
+{
+  return x->kind == y->kind && x->lineno == y->lineno &&
+         x->colno == y->colno && strcmp(x->name, y->name) == 0;
+}
+
+/* Function diagFlush sorts the main buffer by
+ * source position, drops duplicates, prints at
+ * most MaxErrors diagnostics to out in DiagMode
+ * and empties the buffer. It returns the number
+ * of distinct diagnostics
+ */
+int diagFlush(FILE *out)
+{
+  char text[256];
+  int *idx;
+  int i, j, n = 0, shown = 0, first = 0;
+  Diagnostic *f;
+  if (mainBuf.count == 0 && DiagMode == DiagText)
+    return 0;
+  idx = (int *)malloc((mainBuf.count + 1) * sizeof(int));
+  for (i = 0; i < mainBuf.count; i++)
+    idx[i] = i;
+  sortItems = mainBuf.items;
+  qsort(idx, mainBuf.count, sizeof(int), order);
+  if (DiagMode == DiagJSON)
+    fprintf(out, "{\"diagnostics\":[");
+  for (i = 0; i < mainBuf.count; i++)
+  {
+    Diagnostic *d = &mainBuf.items[idx[i]];
+    /* a copy may sit anywhere among the
+     * diagnostics at the same position
+     */
+    f = &mainBuf.items[idx[first]];
+    if (f->lineno != d->lineno || f->colno != d->colno)
+      first = i;
+    for (j = first; j < i && !same(&mainBuf.items[idx[j]], d); j++)
+      ;
+    if (j < i)
+      continue;
+    n++;
+    if (MaxErrors > 0 && shown == MaxErrors)
+      continue;
+    formatMessage(text, sizeof(text), d);
+    if (DiagMode == DiagJSON)
+    {
+      fprintf(out, "%s\n{\"kind\":\"%s\",\"severity\":\"error\",\"line\":%d,\"column\":%d,\"symbol\":",
+              shown > 0 ? "," : "", kindName(d->kind), d->lineno, d->colno);
+      printJSONString(out, d->name);
+      fprintf(out, ",\"message\":");
+      printJSONString(out, text);
+      fprintf(out, "}");
+    }
+    else
+      fprintf(out, "%s\n", text);
+    shown++;
+  }
+  if (DiagMode == DiagJSON)
+    fprintf(out, "\n],\"count\":%d,\"suppressed\":%d}\n", n, n - shown);
+  else if (n > shown)
+    fprintf(out, "Too many errors: %d more not shown\n", n - shown);
+  free(idx);
+  free(mainBuf.items);
+  mainBuf.items = NULL;
+  mainBuf.count = mainBuf.cap = 0;
+  return n;
+}
@@ -0,0 +1,85 @@
+/****************************************************/
+/* File: diag.h                                     */
+/* Diagnostic buffer for the C-Minus compiler       */
+/****************************************************/
+
+#ifndef _DIAG_H_
+#define _DIAG_H_
+
+#include "globals.h"
+
+/* the kinds of semantic errors */
+typedef enum
+{
+  UndecFunc,
+  UndecVar,
+  RedefSym,
+  VoidVar,
+  NoIntIdx,
+  NoArrIdx,
+  InvalCall,
+  InvalReturn,
+  InvalAssign,
+  InvalOper,
+  InvalCond,
+  DivZero,
+  IdxRange,
+} ErrorKind;
+
+/* a recorded diagnostic; the message text is
+ * only formatted when the buffer is printed
+ */
+typedef struct
+{
+  ErrorKind kind;
+  int lineno;
+  int colno;
+  char *name; /* symbol involved, not copied */
+} Diagnostic;
+
+typedef struct
+{
+  Diagnostic *items;
+  int count;
+  int cap;
+} DiagBuffer;
+
+/* output formats of diagFlush */
+typedef enum
+{
+  DiagText,
+  DiagJSON
+} DiagFormat;
+
+/* DiagMode selects the format and MaxErrors
+ * (0 = no limit) how many diagnostics
+ * diagFlush prints
+ */
+extern DiagFormat DiagMode;
+extern int MaxErrors;
+
+/* Procedure diagReport records a diagnostic in
+ * the calling thread's buffer
+ */
+void diagReport(ErrorKind kind, char *name, int lineno, int colno);
+
+/* Function diagSetBuffer makes buf the calling
+ * thread's buffer (NULL = the main buffer) and
+ * returns the previous one
+ */
+DiagBuffer *diagSetBuffer(DiagBuffer *buf);
+
+/* Procedure diagAppend moves the contents of
+ * buf to the end of the main buffer
+ */
+void diagAppend(DiagBuffer *buf);
+
+/* Function diagFlush sorts the main buffer by
+ * source position, drops duplicates, prints at
+ * most MaxErrors diagnostics to out in
+ * DiagMode and empties the buffer. It returns
+ * the number of distinct diagnostics
+ */
+int diagFlush(FILE *out);
+
+#endif
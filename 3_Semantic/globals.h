@@ -57,6 +57,7 @@ extern FILE *listing; /* listing output text file */
 extern FILE *code;    /* code text file for TM simulator */
 
 extern int lineno; /* source line number for listing */
+extern int colno;  /* source column of the current token */
 
 /**************************************************/
 /***********   Syntax tree for parsing ************/
@@ -103,7 +104,9 @@ typedef struct treeNode
 {
    struct treeNode *child[MAXCHILDREN];
    struct treeNode *sibling;
+   int id; /* 1, 2, ... in order of creation */
    int lineno;
+   int colno;
    NodeKind nodekind;
    union
    {
@@ -117,6 +120,8 @@ typedef struct treeNode
       char *name;
    } attr;
    ExpType type; /* for type checking of exps */
+   struct BucketListRec *symbol; /* symbol resolved by buildSymtab */
+   struct ScopeListRec *scope;   /* scope opened by FunDeclK/CompK */
 } TreeNode;
 
 /**************************************************/
@@ -151,6 +156,14 @@ extern int TraceAnalyze;
  */
 extern int TraceCode;
 
+/* ShadowScopes = TRUE makes the symbol table keep
+ * one stack of bindings per interned name while
+ * scopes are entered and left, so that lookups
+ * during buildSymtab take a single probe
+ * regardless of nesting depth
+ */
+extern int ShadowScopes;
+
 /* Error = TRUE prevents further passes if an error occurs */
 extern int Error;
 #endif
@@ -0,0 +1,324 @@
+/****************************************************/
+/* File: incr.c                                     */
+/* Incremental re-analysis cache for the            */
+/* C-Minus compiler                                 */
+/****************************************************/
+
+#include "globals.h"
+#include "symtab.h"
+#include "util.h"
+#include "incr.h"
+
+#define CACHE_MAGIC "cminus-incr 1"
+
+typedef unsigned long long Hash;
+
+/* a global or built-in referenced by a function,
+ * with a hash of the signature it had
+ */
+typedef struct
+{
+  char *name;
+  Hash sig;
+} Dep;
+
+/* what is known about one function: a hash of
+ * its declaration tree (without line numbers),
+ * whether it was checked without errors and the
+ * globals it depends on, in order of first use
+ */
+typedef struct
+{
+  char *name;
+  Hash body;
+  int clean;
+  Dep *deps;
+  int ndeps;
+} FuncRec;
+
+typedef struct
+{
+  FuncRec *recs;
+  int count;
+  int cap;
+} FuncTable;
+
+/* prev is the cache read by incrLoad, sorted by
+ * name; next collects the records to be saved
+ */
+static FuncTable prev = {NULL, 0, 0};
+static FuncTable next = {NULL, 0, 0};
+
+/* reused counts the functions left unchecked,
+ * recorded those passed to incrRecord
+ */
+static int reused = 0;
+static int recorded = 0;
+
+/* FNV-1a */
+static Hash mix(Hash h, const void *p, size_t n)
+{
+  const unsigned char *s = (const unsigned char *)p;
+  while (n-- > 0)
+    h = (h ^ *s++) * 1099511628211ULL;
+  return h;
+}
+
+static Hash mixInt(Hash h, int v)
+{
+  return mix(h, &v, sizeof(v));
+}
+
+static Hash mixStr(Hash h, char *s)
+{
+  return mix(h, s, strlen(s) + 1);
+}
+
+#define HASH_INIT 14695981039346656037ULL
+
+/* Function hashTree hashes the structure of t
+ * (and its siblings if siblings is set); line
+ * and column numbers are left out so that moving
+ * a function does not make it dirty
+ */
+static Hash hashTree(Hash h, TreeNode *t, int siblings)
+{
+  int i;
+  for (; t != NULL; t = siblings ? t->sibling : NULL)
+  {
+    h = mixInt(h, t->nodekind);
+    h = mixInt(h, t->nodekind == StmtK ? (int)t->kind.stmt : (int)t->kind.exp);
+    h = mixInt(h, t->type);
+    if (t->nodekind == ExpK && t->kind.exp == OpK)
+      h = mixInt(h, t->attr.op);
+    else if (t->nodekind == ExpK && t->kind.exp == ConstK)
+      h = mixInt(h, t->attr.val);
+    else if (t->attr.name != NULL &&
+             (t->nodekind == StmtK
+                  ? t->kind.stmt == VarDeclK || t->kind.stmt == FunDeclK
+                  : t->kind.exp == IdK || t->kind.exp == ParamK || t->kind.exp == CallK))
+      h = mixStr(h, t->attr.name);
+    for (i = 0; i < MAXCHILDREN; i++)
+      h = t->child[i] != NULL ? hashTree(h, t->child[i], TRUE) : mixInt(h, -1);
+    if (!siblings)
+      break;
+  }
+  return mixInt(h, -2);
+}
+
+/* Function hashSig hashes what type checking
+ * a use of symbol l depends on
+ */
+static Hash hashSig(BucketList l)
+{
+  TreeNode *d = l->treeNode;
+  Hash h = HASH_INIT;
+  h = mixInt(h, l->type);
+  h = mixInt(h, l->arity);
+  if (l->arity > 0)
+    h = mix(h, l->paramTypes, l->arity);
+  if (d != NULL && d->nodekind == StmtK && d->kind.stmt == VarDeclK && d->child[0] != NULL)
+    h = mixInt(h, d->child[0]->attr.val); /* array size, for index checks */
+  return h;
+}
+
+static int isGlobal(ScopeList s)
+{
+  return s == preludeScope() || s->parent == preludeScope();
+}
+
+/* Function collectDeps adds the globals used
+ * in t to r; it returns FALSE if a name was not
+ * resolved by buildSymtab, in which case the
+ * function is never taken from the cache
+ */
+static int collectDeps(TreeNode *t, FuncRec *r, int *cap)
+{
+  int i;
+  for (; t != NULL; t = t->sibling)
+  {
+    if (t->nodekind == ExpK && (t->kind.exp == IdK || t->kind.exp == CallK))
+    {
+      BucketList l = t->symbol;
+      if (l == NULL)
+        return FALSE;
+      if (isGlobal(l->scope))
+      {
+        for (i = 0; i < r->ndeps; i++)
+          if (strcmp(r->deps[i].name, l->name) == 0)
+            break;
+        if (i == r->ndeps)
+        {
+          if (r->ndeps == *cap)
+          {
+            *cap = *cap ? 2 * *cap : 8;
+            r->deps = (Dep *)realloc(r->deps, *cap * sizeof(Dep));
+          }
+          r->deps[r->ndeps].name = l->name;
+          r->deps[r->ndeps].sig = hashSig(l);
+          r->ndeps++;
+        }
+      }
+    }
+    for (i = 0; i < MAXCHILDREN; i++)
+      if (!collectDeps(t->child[i], r, cap))
+        return FALSE;
+  }
+  return TRUE;
+}
+
+/* Function describe fills r in for function
+ * declaration t; it returns FALSE if t cannot
+ * be cached
+ */
+static int describe(TreeNode *t, FuncRec *r)
+{
+  int cap = 0;
+  r->name = t->attr.name;
+  r->body = hashTree(HASH_INIT, t, FALSE);
+  r->clean = FALSE;
+  r->deps = NULL;
+  r->ndeps = 0;
+  if (t->symbol == NULL)
+    return FALSE; /* redefined */
+  return collectDeps(t->child[0], r, &cap) && collectDeps(t->child[1], r, &cap);
+}
+
+static FuncRec *append(FuncTable *tab)
+{
+  if (tab->count == tab->cap)
+  {
+    tab->cap = tab->cap ? 2 * tab->cap : 16;
+    tab->recs = (FuncRec *)realloc(tab->recs, tab->cap * sizeof(FuncRec));
+  }
+  return &tab->recs[tab->count++];
+}
+
+static int byName(const void *a, const void *b)
+{
+  return strcmp(((const FuncRec *)a)->name, ((const FuncRec *)b)->name);
+}
+
+static FuncRec *findPrev(char *name)
+{
+  FuncRec key;
+  key.name = name;
+  return (FuncRec *)bsearch(&key, prev.recs, prev.count, sizeof(FuncRec), byName);
+}
+
+/* Procedure incrLoad reads the results of the
+ * previous compilation from file
+ */
+void incrLoad(char *file)
+{
+  FILE *in = fopen(file, "r");
+  char line[64], name[256];
+  FuncRec *r;
+  int i;
+  reused = recorded = 0;
+  next.count = 0;
+  if (in == NULL)
+    return;
+  if (fgets(line, sizeof(line), in) == NULL ||
+      strncmp(line, CACHE_MAGIC "\n", sizeof(CACHE_MAGIC)) != 0)
+  {
+    fclose(in);
+    return;
+  }
+  for (;;)
+  {
+    Hash body;
+    int clean, ndeps;
+    if (fscanf(in, " fun %255s %llx %d %d", name, &body, &clean, &ndeps) != 4 || ndeps < 0)
+      break;
+    r = append(&prev);
+    r->name = copyString(name);
+    r->body = body;
+    r->clean = clean;
+    r->ndeps = 0;
+    r->deps = (Dep *)malloc((ndeps > 0 ? ndeps : 1) * sizeof(Dep));
+    for (i = 0; i < ndeps; i++)
+    {
+      if (fscanf(in, " dep %255s %llx", name, &r->deps[i].sig) != 2)
+      {
+        r->clean = FALSE; /* truncated */
+        break;
+      }
+      r->deps[i].name = copyString(name);
+      r->ndeps++;
+    }
+  }
+  fclose(in);
+  qsort(prev.recs, prev.count, sizeof(FuncRec), byName);
+}
+
+/* Function incrUnchanged tells whether function
+ * declaration t can be left unchecked. It
+ * describes t before type checking changes it,
+ * and keeps the description for incrRecord
+ */
+int incrUnchanged(TreeNode *t)
+{
+  FuncRec *cur = append(&next), *old;
+  int i, same;
+  /* clean means cacheable until incrRecord */
+  cur->clean = describe(t, cur);
+  if (!cur->clean)
+    return FALSE;
+  old = findPrev(t->attr.name);
+  same = old != NULL && old->clean && old->body == cur->body && old->ndeps == cur->ndeps;
+  if (TraceAnalyze && old != NULL && old->clean && !same && old->body == cur->body)
+    fprintf(listing, "  %s: uses of globals changed\n", t->attr.name);
+  for (i = 0; same && i < cur->ndeps; i++)
+  {
+    if (strcmp(old->deps[i].name, cur->deps[i].name) != 0)
+      same = FALSE;
+    else if (old->deps[i].sig != cur->deps[i].sig)
+    {
+      same = FALSE;
+      if (TraceAnalyze)
+        fprintf(listing, "  %s: signature of %s changed\n", t->attr.name, cur->deps[i].name);
+    }
+  }
+  if (same)
+    reused++;
+  return same;
+}
+
+/* Procedure incrRecord remembers the result of
+ * checking the next function given to
+ * incrUnchanged
+ */
+void incrRecord(int clean)
+{
+  FuncRec *r = &next.recs[recorded++];
+  r->clean = r->clean && clean;
+}
+
+/* Procedure incrSave writes the recorded
+ * results to file
+ */
+void incrSave(char *file)
+{
+  FILE *out = fopen(file, "w");
+  int i, j;
+  if (TraceAnalyze)
+    fprintf(listing, "\nIncremental: %d of %d functions re-checked\n",
+            next.count - reused, next.count);
+  if (out == NULL)
+  {
+    fprintf(listing, "Unable to write %s\n", file);
+    return;
+  }
+  fprintf(out, "%s\n", CACHE_MAGIC);
+  for (i = 0; i < next.count; i++)
+  {
+    FuncRec *r = &next.recs[i];
+    fprintf(out, "fun %s %llx %d %d\n", r->name, r->body, r->clean, r->ndeps);
+    for (j = 0; j < r->ndeps; j++)
+      fprintf(out, " dep %s %llx\n", r->deps[j].name, r->deps[j].sig);
+    free(r->deps);
+  }
+  fclose(out);
+  next.count = 0;
+}
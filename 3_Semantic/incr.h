@@ -0,0 +1,40 @@
+/****************************************************/
+/* File: incr.h                                     */
+/* Incremental re-analysis cache for the            */
+/* C-Minus compiler                                 */
+/****************************************************/
+
+#ifndef _INCR_H_
+#define _INCR_H_
+
+#include "globals.h"
+
+/* Procedure incrLoad reads the results of the
+ * previous compilation from file; a missing or
+ * unreadable cache leaves every function dirty
+ */
+void incrLoad(char *file);
+
+/* Function incrUnchanged tells whether function
+ * declaration t (after buildSymtab) has the same
+ * body and sees the same signatures of the
+ * globals and functions it references as when
+ * it was last checked clean, so that type
+ * checking it again cannot report anything
+ */
+int incrUnchanged(TreeNode *t);
+
+/* Procedure incrRecord remembers for the next
+ * compilation the result of checking the
+ * functions given to incrUnchanged, one call
+ * per function in the same order
+ */
+void incrRecord(int clean);
+
+/* Procedure incrSave writes the recorded
+ * results to file and prints a summary to the
+ * listing when TraceAnalyze is set
+ */
+void incrSave(char *file);
+
+#endif
@@ -0,0 +1,268 @@
+/****************************************************/
+/* File: inline.c                                   */
+/* Inlining of small functions into the IR of the   */
+/* C-Minus compiler                                 */
+/****************************************************/
+
+#include "globals.h"
+#include "symtab.h"
+#include "util.h"
+#include "ir.h"
+#include "ssa.h"
+#include "opt.h"
+#include "callgraph.h"
+#include "inline.h"
+
+int Inline = TRUE;
+int InlineLimit = 40;
+int InlineGrowth = 200;
+
+/* what irInline did so far */
+static long ninlined = 0, ncopied = 0;
+
+/* size[t->id] is the number of nodes in the body
+ * of function declaration t if it may be
+ * inlined, else -1
+ */
+static int *size = NULL;
+static int nsize = 0;
+
+/* Function countNodes returns the number of
+ * nodes in t, its children and its siblings
+ */
+static int countNodes(TreeNode *t)
+{
+  int i, n = 0;
+  for (; t != NULL; t = t->sibling)
+  {
+    n++;
+    for (i = 0; i < MAXCHILDREN; i++)
+      n += countNodes(t->child[i]);
+  }
+  return n;
+}
+
+/* Function hasLocalArray tells whether t
+ * declares an array, which would need room in
+ * the frame of the caller
+ */
+static int hasLocalArray(TreeNode *t)
+{
+  int i;
+  for (; t != NULL; t = t->sibling)
+  {
+    if (t->nodekind == StmtK && t->kind.stmt == VarDeclK && t->symbol != NULL &&
+        t->symbol->type == IntegerArr)
+      return TRUE;
+    for (i = 0; i < MAXCHILDREN; i++)
+      if (hasLocalArray(t->child[i]))
+        return TRUE;
+  }
+  return FALSE;
+}
+
+/* Procedure planInlining fills in size */
+void planInlining(TreeNode *syntaxTree)
+{
+  char *recursive;
+  TreeNode *t;
+  int i, n;
+  endInlining();
+  recursive = findRecursive(syntaxTree);
+  nsize = maxNodeId() + 1;
+  size = (int *)malloc(nsize * sizeof(int));
+  for (i = 0; i < nsize; i++)
+    size[i] = -1;
+  for (t = syntaxTree; t != NULL; t = t->sibling)
+    if (t->nodekind == StmtK && t->kind.stmt == FunDeclK && !recursive[t->id] &&
+        !hasLocalArray(t->child[1]))
+    {
+      n = countNodes(t->child[1]);
+      if (n <= InlineLimit)
+        size[t->id] = n;
+    }
+  free(recursive);
+}
+
+void endInlining(void)
+{
+  free(size);
+  size = NULL;
+  nsize = 0;
+}
+
+/* Function sizeOf returns the size of the
+ * function called by in if it may be inlined,
+ * else -1
+ */
+static int sizeOf(IrInstr *in)
+{
+  TreeNode *d = in->sym->treeNode;
+  if (d == NULL || d->id <= 0 || d->id >= nsize)
+    return -1; /* built-ins */
+  return size[d->id];
+}
+
+/* Function paramIndex returns the position of
+ * parameter l in the declaration of function d
+ */
+static int paramIndex(TreeNode *d, BucketList l)
+{
+  TreeNode *p;
+  int i = 0;
+  for (p = d->child[0]; p != NULL && p->symbol != l; p = p->sibling)
+    i++;
+  return i;
+}
+
+static int isParam(BucketList l)
+{
+  TreeNode *d = l->treeNode;
+  return d != NULL && d->nodekind == ExpK && d->kind.exp == ParamK;
+}
+
+static void moveAll(IrBlock *from, IrBlock *to)
+{
+  IrInstr *in;
+  while ((in = from->first) != NULL)
+  {
+    irRemove(in);
+    irAppend(to, in);
+  }
+}
+
+/* Procedure splice replaces call in f by the
+ * body of the function it calls, lowered anew.
+ * The parameters become copies of the
+ * arguments, which arrays are passed by
+ * reference as addresses, and the returns
+ * assignments of the result followed by a jump
+ * to the code after the call
+ */
+static void splice(IrFunc *f, IrInstr *call)
+{
+  TreeNode *d = call->sym->treeNode;
+  IrFunc *g = irBuild(d);
+  IrBlock *b = call->block, *entry = g->blocks[0], *rest, **blocks;
+  IrInstr *in, *next, *copy;
+  int *vmap = (int *)malloc((g->nvregs + 1) * sizeof(int));
+  int i, j, n;
+  rest = (IrBlock *)calloc(1, sizeof(IrBlock));
+  for (i = 0; i < g->nvregs; i++)
+    vmap[i] = irNewVreg(f, g->vregVar[i]);
+  /* with several returns the result is assigned
+   * more than once, like a variable
+   */
+  if (call->dst >= 0 && f->vregVar[call->dst] == NULL)
+    f->vregVar[call->dst] = call->sym;
+  for (i = 0; i < g->nblocks; i++)
+    for (in = g->blocks[i]->first; in != NULL; in = next)
+    {
+      next = in->next;
+      if (in->dst >= 0)
+        in->dst = vmap[in->dst];
+      for (j = 0; j < in->nargs; j++)
+        in->args[j] = vmap[in->args[j]];
+      if (in->op == IrParam)
+      {
+        in->op = IrCopy;
+        in->nargs = 1;
+        in->args[0] = call->args[paramIndex(d, in->sym)];
+        in->sym = NULL;
+      }
+      else if (in->op == IrRet)
+      {
+        if (in->nargs > 0 && call->dst >= 0)
+        {
+          copy = irNew(IrCopy, call->dst, 1);
+          copy->args[0] = in->args[0];
+          irInsertBefore(in->block, in, copy);
+        }
+        in->op = IrJump;
+        in->nargs = 0;
+        in->target[0] = rest;
+      }
+    }
+  /* locals read before they are assigned read 0
+   * on every call, as they do in the callee
+   */
+  for (i = 0; i < g->nvregs; i++)
+    if (g->vregVar[i] != NULL && !isParam(g->vregVar[i]))
+      irInsertBefore(entry, entry->first, irNew(IrConst, vmap[i], 0));
+  while (call->next != NULL)
+  {
+    in = call->next;
+    irRemove(in);
+    irAppend(rest, in);
+  }
+  irDelete(call);
+  moveAll(entry, b);
+  if (g->nblocks == 1)
+  {
+    irDelete(b->last); /* the jump to rest */
+    moveAll(rest, b);
+    free(rest);
+    rest = NULL;
+  }
+  /* lay the body out between b and rest */
+  n = f->nblocks + g->nblocks - 1 + (rest != NULL);
+  blocks = (IrBlock **)malloc(n * sizeof(IrBlock *));
+  for (i = 0, n = 0; i <= b->id; i++)
+    blocks[n++] = f->blocks[i];
+  for (j = 1; j < g->nblocks; j++)
+    blocks[n++] = g->blocks[j];
+  if (rest != NULL)
+    blocks[n++] = rest;
+  for (; i < f->nblocks; i++)
+    blocks[n++] = f->blocks[i];
+  for (i = 0; i < n; i++)
+    blocks[i]->id = i;
+  free(f->blocks);
+  f->blocks = blocks;
+  f->nblocks = f->blockCap = n;
+  free(entry->succ);
+  free(entry->pred);
+  free(entry);
+  free(g->blocks);
+  free(g->vregVar);
+  free(g);
+  free(vmap);
+  irCFG(f);
+}
+
+/* Procedure irInline inlines the calls of f,
+ * one at a time so that the calls in the bodies
+ * copied can be inlined as well
+ */
+void irInline(IrFunc *f)
+{
+  IrInstr *in, *best;
+  int i, n, grown = 0;
+  if (size == NULL)
+    return;
+  for (;;)
+  {
+    irLoopDepth(f);
+    best = NULL;
+    for (i = 0; i < f->nblocks; i++)
+      for (in = f->blocks[i]->first; in != NULL; in = in->next)
+        if (in->op == IrCall && (n = sizeOf(in)) >= 0 && grown + n <= InlineGrowth &&
+            (best == NULL || in->block->depth > best->block->depth))
+          best = in;
+    if (best == NULL)
+      break;
+    n = sizeOf(best);
+    grown += n;
+    ncopied += n;
+    ninlined++;
+    splice(f, best);
+  }
+}
+
+/* Procedure printInlineStats prints to out what
+ * irInline did so far
+ */
+void printInlineStats(FILE *out)
+{
+  fprintf(out, "  inline: %ld calls inlined, %ld nodes copied\n", ninlined, ncopied);
+}
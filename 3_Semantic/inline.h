@@ -0,0 +1,38 @@
+/****************************************************/
+/* File: inline.h                                   */
+/* Inlining of small functions into the IR of the   */
+/* C-Minus compiler                                 */
+/****************************************************/
+
+#ifndef _INLINE_H_
+#define _INLINE_H_
+
+#include "ir.h"
+
+/* Procedure planInlining finds the functions of
+ * syntaxTree that may be inlined: those that
+ * cannot call themselves, declare no local array
+ * and have at most InlineLimit nodes in their
+ * body
+ */
+void planInlining(TreeNode *syntaxTree);
+
+/* Procedure endInlining forgets what
+ * planInlining found
+ */
+void endInlining(void);
+
+/* Procedure irInline replaces the calls of f to
+ * functions picked by planInlining by copies of
+ * their bodies, those in the deepest loops
+ * first, until the bodies copied add up to
+ * InlineGrowth nodes. f must not be in SSA form
+ */
+void irInline(IrFunc *f);
+
+/* Procedure printInlineStats prints to out what
+ * irInline did so far
+ */
+void printInlineStats(FILE *out);
+
+#endif
@@ -0,0 +1,753 @@
+/****************************************************/
+/* File: ir.c                                       */
+/* Three-address intermediate representation of     */
+/* the C-Minus compiler: construction from the      */
+/* syntax tree and printing                         */
+/****************************************************/
+
+#include "globals.h"
+#include "symtab.h"
+#include "util.h"
+#include "ir.h"
+
+/* Function irNewVreg returns a new vreg of f */
+int irNewVreg(IrFunc *f, BucketList var)
+{
+  if (f->nvregs == f->vregCap)
+  {
+    f->vregCap = f->vregCap ? 2 * f->vregCap : 64;
+    f->vregVar = (BucketList *)realloc(f->vregVar, f->vregCap * sizeof(BucketList));
+  }
+  f->vregVar[f->nvregs] = var;
+  return f->nvregs++;
+}
+
+/* Procedure place appends block b to the layout
+ * of f
+ */
+static void place(IrFunc *f, IrBlock *b)
+{
+  if (f->nblocks == f->blockCap)
+  {
+    f->blockCap = f->blockCap ? 2 * f->blockCap : 16;
+    f->blocks = (IrBlock **)realloc(f->blocks, f->blockCap * sizeof(IrBlock *));
+  }
+  b->id = f->nblocks;
+  f->blocks[f->nblocks++] = b;
+}
+
+/* Function irNewBlock appends an empty block to f */
+IrBlock *irNewBlock(IrFunc *f)
+{
+  IrBlock *b = (IrBlock *)calloc(1, sizeof(IrBlock));
+  place(f, b);
+  return b;
+}
+
+/* Function irNew returns a new instruction */
+IrInstr *irNew(IrOp op, int dst, int nargs)
+{
+  IrInstr *in = (IrInstr *)calloc(1, sizeof(IrInstr));
+  in->op = op;
+  in->dst = dst;
+  in->nargs = nargs;
+  in->args = (int *)calloc(nargs > 0 ? nargs : 1, sizeof(int));
+  return in;
+}
+
+/* Procedure irInsertBefore adds in before pos,
+ * or at the end of b if pos is NULL
+ */
+void irInsertBefore(IrBlock *b, IrInstr *pos, IrInstr *in)
+{
+  in->block = b;
+  in->next = pos;
+  in->prev = pos != NULL ? pos->prev : b->last;
+  if (in->prev != NULL)
+    in->prev->next = in;
+  else
+    b->first = in;
+  if (pos != NULL)
+    pos->prev = in;
+  else
+    b->last = in;
+}
+
+/* Procedure irAppend adds in at the end of b */
+void irAppend(IrBlock *b, IrInstr *in)
+{
+  irInsertBefore(b, NULL, in);
+}
+
+/* Procedure irRemove unlinks in from its block */
+void irRemove(IrInstr *in)
+{
+  IrBlock *b = in->block;
+  if (in->prev != NULL)
+    in->prev->next = in->next;
+  else
+    b->first = in->next;
+  if (in->next != NULL)
+    in->next->prev = in->prev;
+  else
+    b->last = in->prev;
+  in->prev = in->next = NULL;
+  in->block = NULL;
+}
+
+/* Procedure irDelete unlinks and frees in */
+void irDelete(IrInstr *in)
+{
+  irRemove(in);
+  free(in->args);
+  free(in->from);
+  free(in);
+}
+
+int irIsTerminator(IrInstr *in)
+{
+  return in != NULL && (in->op == IrJump || in->op == IrBranch || in->op == IrRet);
+}
+
+static void freeBlock(IrBlock *b)
+{
+  IrInstr *in, *next;
+  for (in = b->first; in != NULL; in = next)
+  {
+    next = in->next;
+    free(in->args);
+    free(in->from);
+    free(in);
+  }
+  free(b->succ);
+  free(b->pred);
+  free(b);
+}
+
+/* Procedure irFree frees function f */
+void irFree(IrFunc *f)
+{
+  int i;
+  for (i = 0; i < f->nblocks; i++)
+    freeBlock(f->blocks[i]);
+  free(f->blocks);
+  free(f->vregVar);
+  free(f);
+}
+
+/***********************************************/
+/* construction from the syntax tree           */
+/***********************************************/
+
+/* the function being built, the block code is
+ * added to, and varReg[t->id], the vreg of the
+ * scalar or array parameter declared by t.
+ * Blocks are created unplaced and take their
+ * place in the layout when code is added to
+ * them, so that the layout follows the source
+ */
+static IrFunc *fn;
+static IrBlock *cur;
+static int *varReg;
+
+/* Procedure emit adds in to the current block;
+ * code after a terminator goes to a new block,
+ * which irCFG drops as unreachable
+ */
+static IrInstr *emit(IrInstr *in)
+{
+  if (irIsTerminator(cur->last))
+    cur = irNewBlock(fn);
+  irAppend(cur, in);
+  return in;
+}
+
+static IrBlock *newBlock(void)
+{
+  return (IrBlock *)calloc(1, sizeof(IrBlock));
+}
+
+/* Procedure startBlock places b and makes it
+ * current; if fall is set the current block
+ * falls through to it
+ */
+static void startBlock(IrBlock *b, int fall)
+{
+  IrInstr *in;
+  if (fall && !irIsTerminator(cur->last))
+  {
+    in = irNew(IrJump, -1, 0);
+    in->target[0] = b;
+    irAppend(cur, in);
+  }
+  place(fn, b);
+  cur = b;
+}
+
+static int isLocal(BucketList l)
+{
+  return l->scope->parent != preludeScope();
+}
+
+/* Function varOf returns the vreg of variable l
+ * if it lives in one, else -1
+ */
+static int varOf(BucketList l)
+{
+  TreeNode *d = l->treeNode;
+  if (!isLocal(l) || (l->type == IntegerArr && d->nodekind != ExpK))
+    return -1;
+  if (varReg[d->id] < 0)
+    varReg[d->id] = irNewVreg(fn, l);
+  return varReg[d->id];
+}
+
+static int lowerExp(TreeNode *t);
+static int lowerAssign(TreeNode *t);
+
+/* Function hasAssign tells whether t assigns to
+ * a variable
+ */
+static int hasAssign(TreeNode *t)
+{
+  int i;
+  for (; t != NULL; t = t->sibling)
+  {
+    if (t->nodekind == StmtK && t->kind.stmt == AssignK)
+      return TRUE;
+    for (i = 0; i < MAXCHILDREN; i++)
+      if (hasAssign(t->child[i]))
+        return TRUE;
+  }
+  return FALSE;
+}
+
+/* Function stable returns v, or a copy of it if
+ * v is a variable that rest, evaluated before v
+ * is used, may assign
+ */
+static int stable(int v, TreeNode *rest)
+{
+  IrInstr *in;
+  if (v < 0 || fn->vregVar[v] == NULL || !hasAssign(rest))
+    return v;
+  in = emit(irNew(IrCopy, irNewVreg(fn, NULL), 1));
+  in->args[0] = v;
+  return in->dst;
+}
+
+/* Function lowerBase returns a vreg holding the
+ * address of the first element of array l
+ */
+static int lowerBase(BucketList l)
+{
+  IrInstr *in;
+  int v = varOf(l);
+  if (v >= 0)
+    return v; /* array parameter */
+  in = emit(irNew(IrAddr, irNewVreg(fn, NULL), 0));
+  in->sym = l;
+  return in->dst;
+}
+
+/* Function lowerExp lowers expression t and
+ * returns the vreg holding its value, -1 for a
+ * call of a void function
+ */
+static int lowerExp(TreeNode *t)
+{
+  IrInstr *in;
+  TreeNode *p;
+  BucketList l = t->symbol;
+  int base, n, v;
+  if (t->nodekind == StmtK)
+    return lowerAssign(t);
+  switch (t->kind.exp)
+  {
+  case ConstK:
+    in = emit(irNew(IrConst, irNewVreg(fn, NULL), 0));
+    in->imm = t->attr.val;
+    return in->dst;
+  case IdK:
+    if (t->child[0] != NULL)
+    {
+      base = lowerBase(l);
+      v = lowerExp(t->child[0]);
+      in = emit(irNew(IrLoadElem, irNewVreg(fn, NULL), 2));
+      in->args[0] = base;
+      in->args[1] = v;
+      return in->dst;
+    }
+    if (l->type == IntegerArr)
+      return lowerBase(l); /* arrays are passed by reference */
+    if ((v = varOf(l)) >= 0)
+      return v;
+    in = emit(irNew(IrLoad, irNewVreg(fn, NULL), 0));
+    in->sym = l;
+    return in->dst;
+  case CallK:
+    if (l->scope == preludeScope())
+    {
+      if (strcmp(l->name, "input") == 0)
+        return emit(irNew(IrIn, irNewVreg(fn, NULL), 0))->dst;
+      v = lowerExp(t->child[0]);
+      emit(irNew(IrOut, -1, 1))->args[0] = v;
+      return -1;
+    }
+    for (n = 0, p = t->child[0]; p != NULL; p = p->sibling)
+      n++;
+    in = irNew(IrCall, l->type == Void ? -1 : irNewVreg(fn, NULL), n);
+    in->sym = l;
+    for (n = 0, p = t->child[0]; p != NULL; p = p->sibling)
+      in->args[n++] = stable(lowerExp(p), p->sibling);
+    return emit(in)->dst;
+  case OpK:
+    base = stable(lowerExp(t->child[0]), t->child[1]);
+    v = lowerExp(t->child[1]);
+    in = emit(irNew(IrBin, irNewVreg(fn, NULL), 2));
+    in->rel = t->attr.op;
+    in->args[0] = base;
+    in->args[1] = v;
+    return in->dst;
+  default:
+    return -1;
+  }
+}
+
+static int isRelop(TokenType op)
+{
+  return op == LT || op == LE || op == GT || op == GE || op == EQ || op == NE;
+}
+
+/* Procedure lowerCond ends the current block
+ * with a branch on test t to tb if it holds,
+ * else to fb
+ */
+static void lowerCond(TreeNode *t, IrBlock *tb, IrBlock *fb)
+{
+  IrInstr *in;
+  int a, b;
+  if (t->nodekind == ExpK && t->kind.exp == OpK && isRelop(t->attr.op))
+  {
+    a = stable(lowerExp(t->child[0]), t->child[1]);
+    b = lowerExp(t->child[1]);
+    in = irNew(IrBranch, -1, 2);
+    in->rel = t->attr.op;
+    in->args[0] = a;
+    in->args[1] = b;
+  }
+  else
+  {
+    a = lowerExp(t);
+    in = irNew(IrBranch, -1, 1);
+    in->rel = NE;
+    in->args[0] = a;
+  }
+  in->target[0] = tb;
+  in->target[1] = fb;
+  emit(in);
+}
+
+static void lowerStmts(TreeNode *t);
+
+/* Function lowerAssign lowers assignment t and
+ * returns the vreg holding the value assigned
+ */
+static int lowerAssign(TreeNode *t)
+{
+  IrInstr *in;
+  BucketList l = t->child[0]->symbol;
+  int base, idx, v, var;
+  if (t->child[0]->child[0] != NULL)
+  {
+    base = lowerBase(l);
+    idx = stable(lowerExp(t->child[0]->child[0]), t->child[1]);
+    v = lowerExp(t->child[1]);
+    in = emit(irNew(IrStoreElem, -1, 3));
+    in->args[0] = base;
+    in->args[1] = idx;
+    in->args[2] = v;
+    return v;
+  }
+  var = varOf(l);
+  v = lowerExp(t->child[1]);
+  if (var < 0)
+  {
+    in = emit(irNew(IrStore, -1, 1));
+    in->args[0] = v;
+    in->sym = l;
+    return v;
+  }
+  /* a temporary just computed is assigned to the
+   * variable directly
+   */
+  in = cur->last;
+  if (in != NULL && in->dst == v && fn->vregVar[v] == NULL)
+    in->dst = var;
+  else
+    emit(irNew(IrCopy, var, 1))->args[0] = v;
+  return var;
+}
+
+/* Procedure lowerStmt lowers statement t */
+static void lowerStmt(TreeNode *t)
+{
+  IrBlock *b1, *b2, *b3;
+  IrInstr *in;
+  switch (t->kind.stmt)
+  {
+  case CompK:
+    lowerStmts(t->child[1]);
+    break;
+  case IfK:
+  case IfElseK:
+    b1 = newBlock();
+    b2 = newBlock();
+    b3 = t->child[2] != NULL ? newBlock() : b2;
+    lowerCond(t->child[0], b1, b3);
+    startBlock(b1, FALSE);
+    lowerStmts(t->child[1]);
+    if (t->child[2] != NULL)
+    {
+      if (!irIsTerminator(cur->last))
+      {
+        in = emit(irNew(IrJump, -1, 0));
+        in->target[0] = b2;
+      }
+      startBlock(b3, FALSE);
+      lowerStmts(t->child[2]);
+    }
+    startBlock(b2, TRUE);
+    break;
+  case WhileK:
+    /* body, then test, then exit, so that an
+     * iteration ends with a single branch
+     */
+    b1 = newBlock();
+    b2 = newBlock();
+    b3 = newBlock();
+    in = emit(irNew(IrJump, -1, 0));
+    in->target[0] = b2;
+    startBlock(b1, FALSE);
+    lowerStmts(t->child[1]);
+    startBlock(b2, TRUE);
+    lowerCond(t->child[0], b1, b3);
+    startBlock(b3, FALSE);
+    break;
+  case ReturnK:
+    in = irNew(IrRet, -1, t->child[0] != NULL);
+    if (t->child[0] != NULL)
+      in->args[0] = lowerExp(t->child[0]);
+    emit(in);
+    break;
+  case AssignK:
+    lowerAssign(t);
+    break;
+  default:
+    break;
+  }
+}
+
+static void lowerStmts(TreeNode *t)
+{
+  for (; t != NULL; t = t->sibling)
+  {
+    if (t->nodekind == StmtK)
+      lowerStmt(t);
+    else
+      lowerExp(t); /* expression statement */
+  }
+}
+
+/* Function irBuild lowers function declaration
+ * t to the IR
+ */
+IrFunc *irBuild(TreeNode *t)
+{
+  TreeNode *p;
+  IrInstr *in;
+  int i, n = maxNodeId() + 1;
+  fn = (IrFunc *)calloc(1, sizeof(IrFunc));
+  fn->decl = t;
+  varReg = (int *)malloc(n * sizeof(int));
+  for (i = 0; i < n; i++)
+    varReg[i] = -1;
+  cur = irNewBlock(fn);
+  for (p = t->child[0]; p != NULL; p = p->sibling)
+    if (p->nodekind == ExpK && p->kind.exp == ParamK && p->symbol != NULL)
+    {
+      in = emit(irNew(IrParam, varOf(p->symbol), 0));
+      in->sym = p->symbol;
+    }
+  lowerStmts(t->child[1]);
+  if (!irIsTerminator(cur->last))
+    emit(irNew(IrRet, -1, 0));
+  free(varReg);
+  irCFG(fn);
+  return fn;
+}
+
+/* Procedure addEdge records the edge from b to s */
+static void addEdge(IrBlock *b, IrBlock *s)
+{
+  b->succ[b->nsucc++] = s;
+  s->pred = (IrBlock **)realloc(s->pred, (s->npred + 1) * sizeof(IrBlock *));
+  s->pred[s->npred++] = b;
+}
+
+/* Procedure markReachable sets reached[b->id] for
+ * the blocks reachable from b
+ */
+static void markReachable(IrBlock *b, char *reached)
+{
+  IrInstr *in;
+  int i;
+  if (reached[b->id])
+    return;
+  reached[b->id] = TRUE;
+  in = b->last;
+  if (irIsTerminator(in) && in->op != IrRet)
+    for (i = 0; i < (in->op == IrBranch ? 2 : 1); i++)
+      markReachable(in->target[i], reached);
+}
+
+/* Procedure prunePhi drops the operands of phi
+ * in that come from blocks no longer
+ * predecessors of its block
+ */
+static void prunePhi(IrInstr *in)
+{
+  IrBlock *b = in->block;
+  int i, j, k = 0;
+  for (i = 0; i < in->nargs; i++)
+  {
+    for (j = 0; j < b->npred && b->pred[j] != in->from[i]; j++)
+      ;
+    if (j < b->npred)
+    {
+      in->args[k] = in->args[i];
+      in->from[k++] = in->from[i];
+    }
+  }
+  in->nargs = k;
+}
+
+/* Procedure irCFG recomputes the edges of f and
+ * drops its unreachable blocks
+ */
+void irCFG(IrFunc *f)
+{
+  char *reached = (char *)calloc(f->nblocks, sizeof(char));
+  IrBlock *b;
+  IrInstr *in;
+  int i, n = 0;
+  markReachable(f->blocks[0], reached);
+  for (i = 0; i < f->nblocks; i++)
+  {
+    b = f->blocks[i];
+    if (!reached[i])
+      freeBlock(b);
+    else
+    {
+      b->id = n;
+      f->blocks[n++] = b;
+      free(b->succ);
+      b->succ = (IrBlock **)malloc(2 * sizeof(IrBlock *));
+      b->nsucc = 0;
+      free(b->pred);
+      b->pred = NULL;
+      b->npred = 0;
+    }
+  }
+  f->nblocks = n;
+  free(reached);
+  for (i = 0; i < n; i++)
+  {
+    b = f->blocks[i];
+    in = b->last;
+    if (in->op == IrJump)
+      addEdge(b, in->target[0]);
+    else if (in->op == IrBranch)
+    {
+      addEdge(b, in->target[0]);
+      if (in->target[1] != in->target[0])
+        addEdge(b, in->target[1]);
+    }
+  }
+  for (i = 0; i < n; i++)
+    for (in = f->blocks[i]->first; in != NULL && in->op == IrPhi; in = in->next)
+      prunePhi(in);
+}
+
+/***********************************************/
+/* printing                                    */
+/***********************************************/
+
+static char *opName(TokenType op)
+{
+  switch (op)
+  {
+  case PLUS:
+    return "add";
+  case MINUS:
+    return "sub";
+  case TIMES:
+    return "mul";
+  case OVER:
+    return "div";
+  case LT:
+    return "lt";
+  case LE:
+    return "le";
+  case GT:
+    return "gt";
+  case GE:
+    return "ge";
+  case EQ:
+    return "eq";
+  case NE:
+    return "ne";
+  default:
+    return "?";
+  }
+}
+
+/* Procedure printVreg prints v as t<v> for a
+ * temporary or <name>.<v> for a variable
+ */
+static void printVreg(FILE *out, IrFunc *f, int v)
+{
+  if (v < 0)
+    fprintf(out, "_");
+  else if (f->vregVar[v] != NULL)
+    fprintf(out, "%s.%d", f->vregVar[v]->name, v);
+  else
+    fprintf(out, "t%d", v);
+}
+
+static void printArgs(FILE *out, IrFunc *f, IrInstr *in, int from)
+{
+  int i;
+  for (i = from; i < in->nargs; i++)
+  {
+    if (i > from)
+      fprintf(out, ", ");
+    printVreg(out, f, in->args[i]);
+  }
+}
+
+/* Procedure irPrint prints f to out */
+void irPrint(FILE *out, IrFunc *f)
+{
+  IrBlock *b;
+  IrInstr *in;
+  int i, j;
+  fprintf(out, "function %s\n", f->decl->attr.name);
+  for (i = 0; i < f->nblocks; i++)
+  {
+    b = f->blocks[i];
+    fprintf(out, "B%d:", b->id);
+    if (b->npred > 0)
+    {
+      fprintf(out, "  ; preds");
+      for (j = 0; j < b->npred; j++)
+        fprintf(out, " B%d", b->pred[j]->id);
+    }
+    fprintf(out, "\n");
+    for (in = b->first; in != NULL; in = in->next)
+    {
+      fprintf(out, "  ");
+      if (in->dst >= 0)
+      {
+        printVreg(out, f, in->dst);
+        fprintf(out, " = ");
+      }
+      switch (in->op)
+      {
+      case IrConst:
+        fprintf(out, "%d", in->imm);
+        break;
+      case IrCopy:
+        printVreg(out, f, in->args[0]);
+        break;
+      case IrBin:
+        fprintf(out, "%s ", opName(in->rel));
+        printArgs(out, f, in, 0);
+        if (in->nargs < 2)
+          fprintf(out, ", %d", in->imm);
+        break;
+      case IrParam:
+        fprintf(out, "param %s", in->sym->name);
+        break;
+      case IrLoad:
+        fprintf(out, "load %s", in->sym->name);
+        break;
+      case IrStore:
+        fprintf(out, "store %s, ", in->sym->name);
+        printVreg(out, f, in->args[0]);
+        break;
+      case IrAddr:
+        fprintf(out, "addr %s", in->sym->name);
+        break;
+      case IrLoadElem:
+        fprintf(out, "load ");
+        printVreg(out, f, in->args[0]);
+        fprintf(out, "[");
+        printVreg(out, f, in->args[1]);
+        fprintf(out, "]");
+        break;
+      case IrStoreElem:
+        fprintf(out, "store ");
+        printVreg(out, f, in->args[0]);
+        fprintf(out, "[");
+        printVreg(out, f, in->args[1]);
+        fprintf(out, "], ");
+        printVreg(out, f, in->args[2]);
+        break;
+      case IrCall:
+        fprintf(out, "call %s(", in->sym->name);
+        printArgs(out, f, in, 0);
+        fprintf(out, ")");
+        break;
+      case IrIn:
+        fprintf(out, "input");
+        break;
+      case IrOut:
+        fprintf(out, "output ");
+        printVreg(out, f, in->args[0]);
+        break;
+      case IrPhi:
+        fprintf(out, "phi");
+        for (j = 0; j < in->nargs; j++)
+        {
+          fprintf(out, "%s ", j > 0 ? "," : "");
+          printVreg(out, f, in->args[j]);
+          fprintf(out, " B%d", in->from[j]->id);
+        }
+        break;
+      case IrJump:
+        fprintf(out, "goto B%d", in->target[0]->id);
+        break;
+      case IrBranch:
+        fprintf(out, "if %s ", opName(in->rel));
+        printVreg(out, f, in->args[0]);
+        fprintf(out, ", ");
+        if (in->nargs > 1)
+          printVreg(out, f, in->args[1]);
+        else
+          fprintf(out, "%d", in->imm);
+        fprintf(out, " goto B%d else B%d", in->target[0]->id, in->target[1]->id);
+        break;
+      case IrRet:
+        fprintf(out, "ret");
+        if (in->nargs > 0)
+        {
+          fprintf(out, " ");
+          printVreg(out, f, in->args[0]);
+        }
+        break;
+      }
+      fprintf(out, "\n");
+    }
+  }
+}
@@ -0,0 +1,144 @@
+/****************************************************/
+/* File: ir.h                                       */
+/* Three-address intermediate representation of     */
+/* the C-Minus compiler                             */
+/****************************************************/
+
+#ifndef _IR_H_
+#define _IR_H_
+
+#include "globals.h"
+#include "symtab.h"
+
+/* A function is a list of basic blocks of
+ * instructions on virtual registers (vregs).
+ * Scalar locals and parameters live in vregs of
+ * their own, which may be assigned many times;
+ * every other vreg is a temporary assigned once.
+ * Globals and arrays stay in memory
+ */
+typedef enum
+{
+  IrConst,     /* dst = imm */
+  IrCopy,      /* dst = a0 */
+  IrBin,       /* dst = a0 rel a1 (rel imm if no a1); rel is PLUS .. NE */
+  IrParam,     /* dst = parameter sym */
+  IrLoad,      /* dst = global scalar sym */
+  IrStore,     /* global scalar sym = a0 */
+  IrAddr,      /* dst = address of array sym */
+  IrLoadElem,  /* dst = a0[a1] */
+  IrStoreElem, /* a0[a1] = a2 */
+  IrCall,      /* dst = sym(a0, a1, ...); dst < 0 if void */
+  IrIn,        /* dst = input() */
+  IrOut,       /* output(a0) */
+  IrPhi,       /* dst = phi(a0, a1, ...), ai coming from block from[i] */
+  IrJump,      /* goto target[0] */
+  IrBranch,    /* if a0 rel a1 (rel imm if no a1) goto target[0] else target[1] */
+  IrRet        /* return a0, if there is one */
+} IrOp;
+
+struct IrBlock;
+
+typedef struct IrInstr
+{
+  IrOp op;
+  TokenType rel;
+  int dst; /* vreg assigned, -1 if none */
+  int nargs;
+  int *args; /* vregs read */
+  int imm;
+  BucketList sym;
+  struct IrBlock *target[2];
+  struct IrBlock **from; /* phi: the predecessor of each operand */
+  struct IrBlock *block;
+  struct IrInstr *prev, *next;
+} IrInstr;
+
+typedef struct IrBlock
+{
+  int id; /* index in the function's blocks */
+  IrInstr *first, *last;
+  struct IrBlock **succ;
+  int nsucc;
+  struct IrBlock **pred;
+  int npred;
+  /* set by irDominators: the immediate dominator,
+   * the first child and next sibling in the
+   * dominator tree and the reverse postorder
+   * number
+   */
+  struct IrBlock *idom, *domChild, *domNext;
+  int order;
+  int depth; /* loop nesting depth, set by irLoopDepth */
+} IrBlock;
+
+typedef struct
+{
+  TreeNode *decl;
+  IrBlock **blocks; /* in layout order; blocks[0] is the entry */
+  int nblocks;
+  int blockCap;
+  int nvregs;
+  BucketList *vregVar; /* the variable of each vreg, NULL for temporaries */
+  int vregCap;
+} IrFunc;
+
+/* Function irBuild lowers function declaration
+ * t of an analyzed syntax tree to the IR
+ */
+IrFunc *irBuild(TreeNode *t);
+
+/* Procedure irFree frees function f */
+void irFree(IrFunc *f);
+
+/* Function irNewVreg returns a new vreg of f for
+ * variable var, or a temporary if var is NULL
+ */
+int irNewVreg(IrFunc *f, BucketList var);
+
+/* Function irNewBlock appends an empty block to f */
+IrBlock *irNewBlock(IrFunc *f);
+
+/* Function irNew returns a new instruction with
+ * room for nargs operands
+ */
+IrInstr *irNew(IrOp op, int dst, int nargs);
+
+/* Procedure irAppend adds in at the end of b */
+void irAppend(IrBlock *b, IrInstr *in);
+
+/* Procedure irInsertBefore adds in before pos,
+ * or at the end of b if pos is NULL
+ */
+void irInsertBefore(IrBlock *b, IrInstr *pos, IrInstr *in);
+
+/* Procedure irRemove unlinks in from its block */
+void irRemove(IrInstr *in);
+
+/* Procedure irDelete unlinks and frees in */
+void irDelete(IrInstr *in);
+
+/* Function irIsTerminator tells whether in ends
+ * a block
+ */
+int irIsTerminator(IrInstr *in);
+
+/* Procedure irCFG recomputes the successors and
+ * predecessors of the blocks of f from their
+ * terminators, drops the blocks that cannot be
+ * reached from the entry and renumbers the rest.
+ * Phi operands coming from blocks that are no
+ * longer predecessors are dropped
+ */
+void irCFG(IrFunc *f);
+
+/* Procedure irPrint prints f to out */
+void irPrint(FILE *out, IrFunc *f);
+
+/* Procedure irEmit generates TM code for f, whose
+ * frame has its first free temporary at tmpBase.
+ * f must not contain phis
+ */
+void irEmit(IrFunc *f, int tmpBase);
+
+#endif
@@ -0,0 +1,729 @@
+/****************************************************/
+/* File: irtm.c                                     */
+/* TM code generation from the three-address IR     */
+/* of the C-Minus compiler                          */
+/****************************************************/
+
+#include "globals.h"
+#include "symtab.h"
+#include "code.h"
+#include "cgen.h"
+#include "ir.h"
+#include "ssa.h"
+
+/* vregs are kept in the registers FIRSTREG ..
+ * FIRSTREG+NREGS-1 or in spill slots of the
+ * frame; ac and ac1 are scratch registers
+ */
+#define FIRSTREG 2
+#define NREGS 3
+
+typedef unsigned long Word;
+#define WORDBITS (8 * sizeof(Word))
+
+/* the function being generated */
+static IrFunc *fn;
+
+/* reg[v] is the register of vreg v, or -1 if it
+ * is spilled to slot[v], the offset from fp of
+ * its slot
+ */
+static int *reg;
+static int *slot;
+
+/* remat[v] is the constant or array address that
+ * is the only assignment of vreg v, computed
+ * again where v is read instead of spilled, or
+ * NULL
+ */
+static IrInstr **remat;
+
+/* forward[v] is the scratch register the next
+ * instruction reads vreg v from, if v is assigned
+ * once and read only there, or -1: spilled, v is
+ * computed right into it instead of a slot
+ */
+static int *forward;
+
+/* the location of the code of each block, -1
+ * until it is generated
+ */
+static int *blockLoc;
+
+/* forward jumps to fill in once the blocks they
+ * go to are generated
+ */
+typedef struct
+{
+  int loc;
+  char *op;
+  int r;
+  IrBlock *target;
+} Fixup;
+
+static Fixup *fixups;
+static int nfixups, fixupCap;
+
+/***********************************************/
+/* liveness and register allocation            */
+/***********************************************/
+
+static int setWords;
+
+static int inSet(Word *s, int v)
+{
+  return (s[v / WORDBITS] >> (v % WORDBITS)) & 1;
+}
+
+static void addSet(Word *s, int v)
+{
+  s[v / WORDBITS] |= (Word)1 << (v % WORDBITS);
+}
+
+/* Procedure liveness computes the vregs live on
+ * entry to and exit from each block
+ */
+static void liveness(Word **liveIn, Word **liveOut)
+{
+  Word **use = (Word **)malloc(fn->nblocks * sizeof(Word *));
+  Word **def = (Word **)malloc(fn->nblocks * sizeof(Word *));
+  IrBlock *b;
+  IrInstr *in;
+  int i, j, w, changed;
+  for (i = 0; i < fn->nblocks; i++)
+  {
+    b = fn->blocks[i];
+    use[i] = (Word *)calloc(setWords, sizeof(Word));
+    def[i] = (Word *)calloc(setWords, sizeof(Word));
+    for (in = b->first; in != NULL; in = in->next)
+    {
+      for (j = 0; j < in->nargs; j++)
+        if (in->args[j] >= 0 && !inSet(def[i], in->args[j]))
+          addSet(use[i], in->args[j]);
+      if (in->dst >= 0)
+        addSet(def[i], in->dst);
+    }
+  }
+  do
+  {
+    changed = FALSE;
+    for (i = fn->nblocks - 1; i >= 0; i--)
+    {
+      b = fn->blocks[i];
+      for (j = 0; j < b->nsucc; j++)
+        for (w = 0; w < setWords; w++)
+          liveOut[i][w] |= liveIn[b->succ[j]->id][w];
+      for (w = 0; w < setWords; w++)
+      {
+        Word n = use[i][w] | (liveOut[i][w] & ~def[i][w]);
+        if (n != liveIn[i][w])
+        {
+          liveIn[i][w] = n;
+          changed = TRUE;
+        }
+      }
+    }
+  } while (changed);
+  for (i = 0; i < fn->nblocks; i++)
+  {
+    free(use[i]);
+    free(def[i]);
+  }
+  free(use);
+  free(def);
+}
+
+/* the live interval of a vreg, in instruction
+ * positions of the block layout
+ */
+typedef struct
+{
+  int v;
+  int start, end;
+  long weight; /* the uses and assignments, those in loops weighing more */
+} Interval;
+
+/* Function cheaper tells whether spilling x
+ * costs less than spilling y: it is used less
+ * for the length of code it holds a register
+ */
+static int cheaper(Interval *x, Interval *y)
+{
+  long cx = x->weight * (y->end - y->start + 1);
+  long cy = y->weight * (x->end - x->start + 1);
+  return cx < cy || (cx == cy && x->end > y->end);
+}
+
+static int byStart(const void *a, const void *b)
+{
+  const Interval *x = (const Interval *)a, *y = (const Interval *)b;
+  if (x->start != y->start)
+    return x->start - y->start;
+  return x->v - y->v;
+}
+
+/* Function allocate assigns each vreg a register
+ * or a spill slot from tmpBase down by linear
+ * scan over the live intervals, and returns the
+ * number of slots used. When the registers run
+ * out the vreg used least for its length
+ * spills, a use in a loop counting eight times
+ * one outside; a vreg computed again where read
+ * costs its reads but the first, and one
+ * forwarded costs nothing. An array address
+ * computed again never takes a register. A vreg
+ * live across a call is always spilled, as the
+ * callee uses the same registers
+ */
+static int allocate(int tmpBase)
+{
+  Word **liveIn, **liveOut;
+  Interval *iv, *active[NREGS];
+  int *calls, ncalls = 0, pos = 0;
+  int nregs = RegAlloc ? NREGS : 0;
+  int i, j, k, v, n, nactive = 0, nslots = 0;
+  long weight;
+  IrBlock *b;
+  IrInstr *in;
+  setWords = (fn->nvregs + WORDBITS - 1) / WORDBITS + 1;
+  liveIn = (Word **)malloc(fn->nblocks * sizeof(Word *));
+  liveOut = (Word **)malloc(fn->nblocks * sizeof(Word *));
+  for (i = 0; i < fn->nblocks; i++)
+  {
+    liveIn[i] = (Word *)calloc(setWords, sizeof(Word));
+    liveOut[i] = (Word *)calloc(setWords, sizeof(Word));
+  }
+  liveness(liveIn, liveOut);
+  irLoopDepth(fn);
+  for (n = 0, i = 0; i < fn->nblocks; i++)
+    for (in = fn->blocks[i]->first; in != NULL; in = in->next)
+      n++;
+  iv = (Interval *)malloc((fn->nvregs + 1) * sizeof(Interval));
+  for (v = 0; v < fn->nvregs; v++)
+  {
+    iv[v].v = v;
+    iv[v].start = 2 * n + 2;
+    iv[v].end = -1;
+    iv[v].weight = 0;
+  }
+  calls = (int *)malloc((n + 1) * sizeof(int));
+  for (i = 0; i < fn->nblocks; i++)
+  {
+    b = fn->blocks[i];
+    weight = 1L << 3 * (b->depth < 6 ? b->depth : 6);
+    for (v = 0; v < fn->nvregs; v++)
+      if (inSet(liveIn[i], v) && iv[v].start > pos)
+        iv[v].start = pos;
+    for (in = b->first; in != NULL; in = in->next, pos += 2)
+    {
+      for (j = 0; j < in->nargs; j++)
+        if ((v = in->args[j]) >= 0)
+        {
+          iv[v].weight += forward[v] >= 0 ? 0 : weight;
+          if (iv[v].start > pos)
+            iv[v].start = pos;
+          if (iv[v].end < pos)
+            iv[v].end = pos;
+        }
+      if ((v = in->dst) >= 0)
+      {
+        iv[v].weight += remat[v] != NULL ? -weight : forward[v] >= 0 ? 0 : weight;
+        if (iv[v].start > pos + 1)
+          iv[v].start = pos + 1;
+        if (iv[v].end < pos + 1)
+          iv[v].end = pos + 1;
+      }
+      if (in->op == IrCall)
+        calls[ncalls++] = pos;
+    }
+    for (v = 0; v < fn->nvregs; v++)
+      if (inSet(liveOut[i], v) && iv[v].end < pos)
+        iv[v].end = pos;
+  }
+  for (v = 0; v < fn->nvregs; v++)
+    if (iv[v].weight < 0)
+      iv[v].weight = 0;
+  qsort(iv, fn->nvregs, sizeof(Interval), byStart);
+  for (i = 0; i < fn->nvregs && iv[i].end >= 0; i++)
+  {
+    Interval *cur = &iv[i];
+    int acrossCall = FALSE;
+    for (k = 0; k < ncalls; k++)
+      if (cur->start < calls[k] && calls[k] + 1 < cur->end)
+        acrossCall = TRUE;
+    /* expire the intervals that ended */
+    for (j = 0, k = 0; j < nactive; j++)
+      if (active[j]->end >= cur->start)
+        active[k++] = active[j];
+    nactive = k;
+    reg[cur->v] = -1;
+    /* an array address computed again costs nothing */
+    if (remat[cur->v] != NULL && remat[cur->v]->op == IrAddr)
+      continue;
+    if (!acrossCall && nregs > 0)
+    {
+      if (nactive < nregs)
+      {
+        /* take a register no active interval has */
+        for (k = FIRSTREG;; k++)
+        {
+          for (j = 0; j < nactive && reg[active[j]->v] != k; j++)
+            ;
+          if (j == nactive)
+            break;
+        }
+        reg[cur->v] = k;
+        active[nactive++] = cur;
+      }
+      else
+      {
+        /* spill the interval used least */
+        for (k = 0, j = 1; j < nactive; j++)
+          if (cheaper(active[j], active[k]))
+            k = j;
+        if (cheaper(active[k], cur))
+        {
+          reg[cur->v] = reg[active[k]->v];
+          reg[active[k]->v] = -1;
+          if (remat[active[k]->v] == NULL && forward[active[k]->v] < 0)
+            slot[active[k]->v] = tmpBase - nslots++;
+          active[k] = cur;
+        }
+      }
+    }
+    if (reg[cur->v] < 0 && remat[cur->v] == NULL && forward[cur->v] < 0)
+      slot[cur->v] = tmpBase - nslots++;
+  }
+  for (i = 0; i < fn->nblocks; i++)
+  {
+    free(liveIn[i]);
+    free(liveOut[i]);
+  }
+  free(liveIn);
+  free(liveOut);
+  free(iv);
+  free(calls);
+  return nslots;
+}
+
+/***********************************************/
+/* instruction selection                       */
+/***********************************************/
+
+/* Function fetch returns the register holding
+ * vreg v, loading it into scratch if spilled
+ */
+static int fetch(int v, int scratch)
+{
+  IrInstr *in = remat[v];
+  if (reg[v] >= 0)
+    return reg[v];
+  if (forward[v] >= 0)
+    return forward[v];
+  if (in != NULL && in->op == IrConst)
+    emitRM("LDC", scratch, in->imm, 0, "load const");
+  else if (in != NULL)
+    emitRM("LDA", scratch, varOffset(in->sym), varBase(in->sym), "compute array address");
+  else
+    emitRM("LD", scratch, slot[v], fp, "load spilled vreg");
+  return scratch;
+}
+
+/* Function base returns the register holding
+ * array address v plus *off, which is the
+ * offset of the array from its base register if
+ * v is that address computed again, else 0
+ */
+static int base(int v, int scratch, int *off)
+{
+  IrInstr *in = remat[v];
+  *off = 0;
+  if (reg[v] >= 0 || in == NULL || in->op != IrAddr)
+    return fetch(v, scratch);
+  *off = varOffset(in->sym);
+  return varBase(in->sym);
+}
+
+/* Function target returns the register to
+ * compute vreg v into: its own, the one it is
+ * forwarded in, or ac
+ */
+static int target(int v)
+{
+  if (reg[v] >= 0)
+    return reg[v];
+  return forward[v] >= 0 ? forward[v] : ac;
+}
+
+/* Procedure put stores vreg v, computed into
+ * target(v), if it is spilled
+ */
+static void put(int v)
+{
+  if (reg[v] < 0 && forward[v] < 0)
+    emitRM("ST", ac, slot[v], fp, "spill vreg");
+}
+
+static char *jumpOf(TokenType rel)
+{
+  switch (rel)
+  {
+  case LT:
+    return "JLT";
+  case LE:
+    return "JLE";
+  case GT:
+    return "JGT";
+  case GE:
+    return "JGE";
+  case EQ:
+    return "JEQ";
+  default:
+    return "JNE";
+  }
+}
+
+static char *negJumpOf(TokenType rel)
+{
+  switch (rel)
+  {
+  case LT:
+    return "JGE";
+  case LE:
+    return "JGT";
+  case GT:
+    return "JLE";
+  case GE:
+    return "JLT";
+  case EQ:
+    return "JNE";
+  default:
+    return "JEQ";
+  }
+}
+
+/* Procedure genJump jumps to block b with op on
+ * register r, or unconditionally if op is NULL
+ */
+static void genJump(char *op, int r, IrBlock *b)
+{
+  if (op == NULL)
+  {
+    op = "LDA";
+    r = pc;
+  }
+  if (blockLoc[b->id] >= 0)
+    emitRM_Abs(op, r, blockLoc[b->id], "jump to block");
+  else
+  {
+    if (nfixups == fixupCap)
+    {
+      fixupCap = fixupCap ? 2 * fixupCap : 64;
+      fixups = (Fixup *)realloc(fixups, fixupCap * sizeof(Fixup));
+    }
+    fixups[nfixups].loc = emitSkip(1);
+    fixups[nfixups].op = op;
+    fixups[nfixups].r = r;
+    fixups[nfixups++].target = b;
+  }
+}
+
+/* Procedure genBranch ends block b with a branch
+ * on register r by op (taken to target[0]),
+ * leaving out jumps to the next block
+ */
+static void genBranch(IrBlock *b, IrInstr *in, int r)
+{
+  IrBlock *next = b->id + 1 < fn->nblocks ? fn->blocks[b->id + 1] : NULL;
+  if (in->target[0] == next)
+    genJump(negJumpOf(in->rel), r, in->target[1]);
+  else
+  {
+    genJump(jumpOf(in->rel), r, in->target[0]);
+    if (in->target[1] != next)
+      genJump(NULL, 0, in->target[1]);
+  }
+}
+
+/* Procedure genInstr generates code for in, in
+ * a frame whose calls go at frame
+ */
+static void genInstr(IrInstr *in, int frame)
+{
+  int x, y, r, i;
+  IrBlock *next;
+  switch (in->op)
+  {
+  case IrConst:
+    if (reg[in->dst] < 0 && remat[in->dst] != NULL)
+      break;
+    emitRM("LDC", target(in->dst), in->imm, 0, "load const");
+    put(in->dst);
+    break;
+  case IrCopy:
+    if (in->dst == in->args[0] ||
+        (reg[in->dst] >= 0 && reg[in->dst] == reg[in->args[0]]))
+      break;
+    if (reg[in->args[0]] < 0 && forward[in->args[0]] < 0 && remat[in->args[0]] != NULL)
+    {
+      /* load the constant or address straight into place */
+      fetch(in->args[0], target(in->dst));
+      put(in->dst);
+      break;
+    }
+    x = fetch(in->args[0], ac);
+    if (reg[in->dst] >= 0)
+      emitRM("LDA", reg[in->dst], 0, x, "copy");
+    else
+      emitRM("ST", x, slot[in->dst], fp, "copy to spilled vreg");
+    break;
+  case IrBin:
+    x = fetch(in->args[0], ac);
+    if (in->nargs > 1)
+      y = fetch(in->args[1], ac1);
+    else if (in->rel == PLUS || in->rel == MINUS)
+    {
+      emitRM("LDA", target(in->dst), in->rel == PLUS ? in->imm : -in->imm, x,
+             in->rel == PLUS ? "op + const" : "op - const");
+      put(in->dst);
+      break;
+    }
+    else if (in->rel != TIMES && in->rel != OVER)
+    {
+      emitRM("LDA", ac1, -in->imm, x, "compare with const");
+      r = target(in->dst);
+      emitRM("LDC", r, 1, 0, "true case");
+      emitRM(jumpOf(in->rel), ac1, 1, pc, "br if true");
+      emitRM("LDC", r, 0, 0, "false case");
+      put(in->dst);
+      break;
+    }
+    else
+    {
+      emitRM("LDC", ac1, in->imm, 0, "load const");
+      y = ac1;
+    }
+    r = target(in->dst);
+    switch (in->rel)
+    {
+    case PLUS:
+      emitRO("ADD", r, x, y, "op +");
+      break;
+    case MINUS:
+      emitRO("SUB", r, x, y, "op -");
+      break;
+    case TIMES:
+      emitRO("MUL", r, x, y, "op *");
+      break;
+    case OVER:
+      emitRO("DIV", r, x, y, "op /");
+      break;
+    default:
+      emitRO("SUB", ac1, x, y, "compare");
+      emitRM("LDC", r, 1, 0, "true case");
+      emitRM(jumpOf(in->rel), ac1, 1, pc, "br if true");
+      emitRM("LDC", r, 0, 0, "false case");
+      break;
+    }
+    put(in->dst);
+    break;
+  case IrParam:
+    emitRM("LD", target(in->dst), varOffset(in->sym), fp, "load parameter");
+    put(in->dst);
+    break;
+  case IrLoad:
+    emitRM("LD", target(in->dst), varOffset(in->sym), varBase(in->sym), "load id value");
+    put(in->dst);
+    break;
+  case IrStore:
+    x = fetch(in->args[0], ac);
+    emitRM("ST", x, varOffset(in->sym), varBase(in->sym), "store id value");
+    break;
+  case IrAddr:
+    if (reg[in->dst] < 0 && remat[in->dst] != NULL)
+      break;
+    emitRM("LDA", target(in->dst), varOffset(in->sym), varBase(in->sym), "compute array address");
+    put(in->dst);
+    break;
+  case IrLoadElem:
+    x = base(in->args[0], ac, &i);
+    y = fetch(in->args[1], ac1);
+    emitRO("ADD", ac, x, y, "element address");
+    emitRM("LD", target(in->dst), i, ac, "load element value");
+    put(in->dst);
+    break;
+  case IrStoreElem:
+    y = fetch(in->args[1], ac);
+    x = base(in->args[0], ac1, &i);
+    emitRO("ADD", ac1, x, y, "element address");
+    x = fetch(in->args[2], ac);
+    emitRM("ST", x, i, ac1, "store element value");
+    break;
+  case IrCall:
+    for (i = 0; i < in->nargs; i++)
+    {
+      x = fetch(in->args[i], ac);
+      emitRM("ST", x, frame - FRAMEHDR - i, fp, "call: store argument");
+    }
+    genCall(frame, in->sym->treeNode);
+    if (in->dst >= 0)
+    {
+      if (reg[in->dst] >= 0)
+        emitRM("LDA", reg[in->dst], 0, ac, "call: result");
+      put(in->dst);
+    }
+    break;
+  case IrIn:
+    emitRO("IN", target(in->dst), 0, 0, "read integer value");
+    put(in->dst);
+    break;
+  case IrOut:
+    x = fetch(in->args[0], ac);
+    emitRO("OUT", x, 0, 0, "write value");
+    break;
+  case IrJump:
+    next = in->block->id + 1 < fn->nblocks ? fn->blocks[in->block->id + 1] : NULL;
+    if (in->target[0] != next)
+      genJump(NULL, 0, in->target[0]);
+    break;
+  case IrBranch:
+    x = fetch(in->args[0], ac);
+    if (in->nargs > 1)
+    {
+      y = fetch(in->args[1], ac1);
+      emitRO("SUB", ac, x, y, "test: compare");
+      x = ac;
+    }
+    else if (in->imm != 0)
+    {
+      emitRM("LDA", ac, -in->imm, x, "test: compare with const");
+      x = ac;
+    }
+    genBranch(in->block, in, x);
+    break;
+  case IrRet:
+    if (in->nargs > 0)
+    {
+      x = fetch(in->args[0], ac);
+      if (x != ac)
+        emitRM("LDA", ac, 0, x, "return value");
+    }
+    genReturn();
+    break;
+  default:
+    emitComment("BUG: phi left in the IR");
+    break;
+  }
+}
+
+/* Procedure findRemat fills remat in */
+static void findRemat(void)
+{
+  char *defined = (char *)calloc(fn->nvregs + 1, sizeof(char));
+  IrInstr *in;
+  int i;
+  remat = (IrInstr **)calloc(fn->nvregs + 1, sizeof(IrInstr *));
+  for (i = 0; i < fn->nblocks; i++)
+    for (in = fn->blocks[i]->first; in != NULL; in = in->next)
+      if (in->dst >= 0)
+      {
+        remat[in->dst] = !defined[in->dst] && (in->op == IrConst || in->op == IrAddr) ? in : NULL;
+        defined[in->dst] = TRUE;
+      }
+  free(defined);
+}
+
+/* Function scratchOf returns the scratch register
+ * in fetches its argument j into, or -1 if it
+ * loads another one there first
+ */
+static int scratchOf(IrInstr *in, int j)
+{
+  switch (in->op)
+  {
+  case IrBin:
+  case IrLoadElem:
+  case IrBranch:
+    return j == 0 ? ac : ac1;
+  case IrStoreElem:
+    return j == 1 ? ac : j == 0 ? ac1 : -1;
+  default:
+    return j == 0 ? ac : -1;
+  }
+}
+
+/* Procedure findForward fills forward in */
+static void findForward(void)
+{
+  int *ndefs = (int *)calloc(fn->nvregs + 1, sizeof(int));
+  int *nuses = (int *)calloc(fn->nvregs + 1, sizeof(int));
+  IrInstr *in;
+  int i, j, v;
+  forward = (int *)malloc((fn->nvregs + 1) * sizeof(int));
+  for (i = 0; i < fn->nblocks; i++)
+    for (in = fn->blocks[i]->first; in != NULL; in = in->next)
+    {
+      for (j = 0; j < in->nargs; j++)
+        if (in->args[j] >= 0)
+          nuses[in->args[j]]++;
+      if (in->dst >= 0)
+        ndefs[in->dst]++;
+    }
+  for (v = 0; v <= fn->nvregs; v++)
+    forward[v] = -1;
+  for (i = 0; i < fn->nblocks; i++)
+    for (in = fn->blocks[i]->first; in != NULL; in = in->next)
+    {
+      v = in->dst;
+      if (v < 0 || ndefs[v] != 1 || nuses[v] != 1 || in->next == NULL ||
+          remat[v] != NULL || in->op == IrCopy)
+        continue;
+      for (j = 0; j < in->next->nargs && in->next->args[j] != v; j++)
+        ;
+      if (j < in->next->nargs)
+        forward[v] = scratchOf(in->next, j);
+      /* a compare and a call leave their result in ac */
+      if (forward[v] == ac1 &&
+          (in->op == IrCall || (in->op == IrBin && in->rel != PLUS && in->rel != MINUS &&
+                                in->rel != TIMES && in->rel != OVER)))
+        forward[v] = -1;
+    }
+  free(ndefs);
+  free(nuses);
+}
+
+/* Procedure irEmit generates TM code for f */
+void irEmit(IrFunc *f, int tmpBase)
+{
+  int i, nslots;
+  IrInstr *in;
+  fn = f;
+  findRemat();
+  findForward();
+  reg = (int *)malloc((f->nvregs + 1) * sizeof(int));
+  slot = (int *)calloc(f->nvregs + 1, sizeof(int));
+  blockLoc = (int *)malloc(f->nblocks * sizeof(int));
+  for (i = 0; i < f->nvregs; i++)
+    reg[i] = -1;
+  nslots = allocate(tmpBase);
+  nfixups = 0;
+  for (i = 0; i < f->nblocks; i++)
+    blockLoc[i] = -1;
+  for (i = 0; i < f->nblocks; i++)
+  {
+    blockLoc[i] = emitSkip(0);
+    for (in = f->blocks[i]->first; in != NULL; in = in->next)
+      genInstr(in, tmpBase - nslots);
+  }
+  for (i = 0; i < nfixups; i++)
+  {
+    emitBackup(fixups[i].loc);
+    emitRM_Abs(fixups[i].op, fixups[i].r, blockLoc[fixups[i].target->id], "jump to block");
+    emitRestore();
+  }
+  free(reg);
+  free(slot);
+  free(remat);
+  free(forward);
+  free(blockLoc);
+}
@@ -0,0 +1,635 @@
+/****************************************************/
+/* File: loop.c                                     */
+/* Loop optimizations over the SSA form of the IR   */
+/* of the C-Minus compiler: loop-invariant code     */
+/* motion and strength reduction of induction       */
+/* variables                                        */
+/****************************************************/
+
+#include "globals.h"
+#include "symtab.h"
+#include "ir.h"
+#include "ssa.h"
+#include "opt.h"
+#include "loop.h"
+
+int HoistInvariants = TRUE;
+int StrengthReduce = TRUE;
+
+/* the function being optimized */
+static IrFunc *fn;
+
+/* what irLoopOpt did so far */
+static long nhoisted = 0, nreduced = 0;
+
+/* A natural loop: its header, the blocks in it
+ * (body[b->id] set), the block entering it from
+ * outside and the block going back to the
+ * header. pre is NULL if the loop is entered
+ * from several blocks, latch if several go back
+ */
+typedef struct
+{
+  IrBlock *header, *pre, *latch;
+  char *body;
+  int size;
+} Loop;
+
+static Loop *loops;
+static int nloops;
+
+/* def[v] is the instruction assigning vreg v */
+static IrInstr **def;
+static int defCap;
+
+static void setDef(int v, IrInstr *in)
+{
+  int n = defCap;
+  if (v >= defCap)
+  {
+    defCap = 2 * fn->nvregs + 16;
+    def = (IrInstr **)realloc(def, defCap * sizeof(IrInstr *));
+    memset(def + n, 0, (defCap - n) * sizeof(IrInstr *));
+  }
+  def[v] = in;
+}
+
+static void findDefs(void)
+{
+  IrInstr *in;
+  int i;
+  free(def);
+  defCap = fn->nvregs + 16;
+  def = (IrInstr **)calloc(defCap, sizeof(IrInstr *));
+  for (i = 0; i < fn->nblocks; i++)
+    for (in = fn->blocks[i]->first; in != NULL; in = in->next)
+      if (in->dst >= 0)
+        def[in->dst] = in;
+}
+
+static int constOf(int v, int *val)
+{
+  if (def[v] == NULL || def[v]->op != IrConst)
+    return FALSE;
+  *val = def[v]->imm;
+  return TRUE;
+}
+
+/* Function variant tells whether vreg v is
+ * assigned inside loop l
+ */
+static int variant(Loop *l, int v)
+{
+  return def[v] != NULL && l->body[def[v]->block->id];
+}
+
+/* Function loopConst tells whether vreg v has
+ * the same value all through loop l
+ */
+static int loopConst(Loop *l, int v)
+{
+  int c;
+  return !variant(l, v) || constOf(v, &c);
+}
+
+/* Function outside returns a vreg holding the
+ * value of loop constant v in the preheader of l
+ */
+static int outside(Loop *l, int v)
+{
+  IrInstr *in;
+  if (!variant(l, v))
+    return v;
+  in = irNew(IrConst, irNewVreg(fn, NULL), 0);
+  in->imm = def[v]->imm;
+  irInsertBefore(l->pre, l->pre->last, in);
+  setDef(in->dst, in);
+  return in->dst;
+}
+
+/***********************************************/
+/* loop detection                              */
+/***********************************************/
+
+static void freeLoops(void)
+{
+  int i;
+  for (i = 0; i < nloops; i++)
+    free(loops[i].body);
+  free(loops);
+  loops = NULL;
+  nloops = 0;
+}
+
+static int bySize(const void *a, const void *b)
+{
+  return ((const Loop *)a)->size - ((const Loop *)b)->size;
+}
+
+/* Procedure findLoops finds the natural loop of
+ * each block some back edge goes to, innermost
+ * loops first
+ */
+static void findLoops(void)
+{
+  int n = fn->nblocks, i, j, nwork, nlatch, nout;
+  IrBlock **work = (IrBlock **)malloc((n + 1) * sizeof(IrBlock *));
+  IrBlock *h, *b;
+  Loop *l;
+  freeLoops();
+  irDominators(fn);
+  loops = (Loop *)malloc((n + 1) * sizeof(Loop));
+  for (i = 0; i < n; i++)
+  {
+    h = fn->blocks[i];
+    l = &loops[nloops];
+    l->header = h;
+    l->body = (char *)calloc(n, sizeof(char));
+    l->body[i] = TRUE;
+    l->latch = NULL;
+    nwork = nlatch = 0;
+    for (j = 0; j < h->npred; j++)
+      if (irDominates(h, h->pred[j]))
+      {
+        l->latch = h->pred[j];
+        nlatch++;
+        if (!l->body[h->pred[j]->id])
+        {
+          l->body[h->pred[j]->id] = TRUE;
+          work[nwork++] = h->pred[j];
+        }
+      }
+    if (nlatch == 0)
+    {
+      free(l->body);
+      continue;
+    }
+    if (nlatch > 1)
+      l->latch = NULL;
+    while (nwork > 0)
+    {
+      b = work[--nwork];
+      for (j = 0; j < b->npred; j++)
+        if (!l->body[b->pred[j]->id])
+        {
+          l->body[b->pred[j]->id] = TRUE;
+          work[nwork++] = b->pred[j];
+        }
+    }
+    l->pre = NULL;
+    for (nout = 0, j = 0; j < h->npred; j++)
+      if (!l->body[h->pred[j]->id])
+      {
+        l->pre = h->pred[j];
+        nout++;
+      }
+    if (nout != 1)
+      l->pre = NULL;
+    for (l->size = 0, j = 0; j < n; j++)
+      l->size += l->body[j];
+    nloops++;
+  }
+  qsort(loops, nloops, sizeof(Loop), bySize);
+  free(work);
+}
+
+/* Function makePreheaders puts a block of its
+ * own on the edge into each loop entered from a
+ * block that also goes elsewhere, and tells
+ * whether it did
+ */
+static int makePreheaders(void)
+{
+  IrBlock *e, *p, *h;
+  IrInstr *in;
+  int i, k, made = FALSE;
+  for (i = 0; i < nloops; i++)
+  {
+    p = loops[i].pre;
+    h = loops[i].header;
+    if (p == NULL || p->nsucc < 2)
+      continue;
+    e = irNewBlock(fn);
+    in = irNew(IrJump, -1, 0);
+    in->target[0] = h;
+    irAppend(e, in);
+    for (k = 0; k < 2; k++)
+      if (p->last->target[k] == h)
+        p->last->target[k] = e;
+    for (in = h->first; in != NULL && in->op == IrPhi; in = in->next)
+      for (k = 0; k < in->nargs; k++)
+        if (in->from[k] == p)
+          in->from[k] = e;
+    made = TRUE;
+  }
+  return made;
+}
+
+/***********************************************/
+/* loop-invariant code motion                  */
+/***********************************************/
+
+/* Function stored tells whether loop l may
+ * change global scalar sym
+ */
+static int stored(Loop *l, BucketList sym)
+{
+  IrInstr *in;
+  int i;
+  for (i = 0; i < fn->nblocks; i++)
+    if (l->body[i])
+      for (in = fn->blocks[i]->first; in != NULL; in = in->next)
+        if (in->op == IrCall || (in->op == IrStore && in->sym == sym))
+          return TRUE;
+  return FALSE;
+}
+
+/* Function invariant tells whether in computes
+ * the same value on every iteration of l and can
+ * run before it even if the loop body never
+ * does: arithmetic that cannot trap and loads of
+ * global scalars the loop does not change
+ */
+static int invariant(Loop *l, IrInstr *in)
+{
+  int i, c;
+  for (i = 0; i < in->nargs; i++)
+    if (!loopConst(l, in->args[i]))
+      return FALSE;
+  switch (in->op)
+  {
+  case IrBin:
+    return in->rel != OVER || (constOf(in->args[1], &c) && c != 0 && c != -1);
+  case IrLoad:
+    return !stored(l, in->sym);
+  default:
+    return FALSE;
+  }
+}
+
+static int byOrder(const void *a, const void *b)
+{
+  return (*(IrBlock *const *)a)->order - (*(IrBlock *const *)b)->order;
+}
+
+/* Procedure hoist moves the invariant
+ * computations of l to its preheader, visiting
+ * its blocks in reverse postorder so that the
+ * ones depending on others hoisted go too
+ */
+static void hoist(Loop *l)
+{
+  IrBlock **list = (IrBlock **)malloc(fn->nblocks * sizeof(IrBlock *));
+  IrInstr *in, *next;
+  int i, k, n = 0;
+  for (i = 0; i < fn->nblocks; i++)
+    if (l->body[i])
+      list[n++] = fn->blocks[i];
+  qsort(list, n, sizeof(IrBlock *), byOrder);
+  for (i = 0; i < n; i++)
+    for (in = list[i]->first; in != NULL; in = next)
+    {
+      next = in->next;
+      if (in->dst >= 0 && invariant(l, in))
+      {
+        for (k = 0; k < in->nargs; k++)
+          in->args[k] = outside(l, in->args[k]);
+        irRemove(in);
+        irInsertBefore(l->pre, l->pre->last, in);
+        nhoisted++;
+      }
+    }
+  free(list);
+}
+
+/***********************************************/
+/* strength reduction                          */
+/***********************************************/
+
+/* An induction variable of a loop: a phi of its
+ * header starting at init before the loop and
+ * going up (rel PLUS) or down (MINUS) by the loop
+ * constant step at inc on every iteration
+ */
+typedef struct
+{
+  IrInstr *phi, *inc;
+  int init, step;
+  TokenType rel;
+} Iv;
+
+/* Function same tells whether vregs x and y
+ * hold the same value, being one or equal
+ * constants
+ */
+static int same(int x, int y)
+{
+  int a, c;
+  return x == y || (constOf(x, &a) && constOf(y, &c) && a == c);
+}
+
+/* Function emitBin computes x rel y before pos
+ * in b, folding constants and reusing the same
+ * computation already in b, and returns its vreg
+ */
+static int emitBin(IrBlock *b, IrInstr *pos, TokenType rel, int x, int y)
+{
+  IrInstr *in;
+  int a, c;
+  for (in = b->first; in != pos; in = in->next)
+    if (in->op == IrBin && in->nargs == 2 && in->rel == rel &&
+        same(in->args[0], x) && same(in->args[1], y))
+      return in->dst;
+  if (constOf(x, &a) && constOf(y, &c))
+  {
+    in = irNew(IrConst, irNewVreg(fn, NULL), 0);
+    in->imm = (int)(rel == PLUS ? (unsigned)a + (unsigned)c
+                  : rel == MINUS ? (unsigned)a - (unsigned)c
+                                 : (unsigned)a * (unsigned)c);
+  }
+  else
+  {
+    in = irNew(IrBin, irNewVreg(fn, NULL), 2);
+    in->rel = rel;
+    in->args[0] = x;
+    in->args[1] = y;
+  }
+  irInsertBefore(b, pos, in);
+  setDef(in->dst, in);
+  return in->dst;
+}
+
+/* Function ivOf tells whether vreg v is an
+ * induction variable of l and fills iv in
+ */
+static int ivOf(Loop *l, int v, Iv *iv)
+{
+  IrInstr *phi = def[v], *d;
+  int k, next = -1;
+  if (phi == NULL || phi->op != IrPhi || phi->block != l->header || phi->nargs != 2)
+    return FALSE;
+  for (k = 0; k < 2; k++)
+    if (phi->from[k] == l->pre)
+      iv->init = phi->args[k];
+    else
+      next = phi->args[k];
+  d = next >= 0 ? def[next] : NULL;
+  if (d == NULL || d->op != IrBin || d->nargs != 2 || !l->body[d->block->id])
+    return FALSE;
+  iv->phi = phi;
+  iv->inc = d;
+  iv->rel = d->rel;
+  if (d->rel == PLUS && d->args[0] == v && loopConst(l, d->args[1]))
+    iv->step = d->args[1];
+  else if (d->rel == PLUS && d->args[1] == v && loopConst(l, d->args[0]))
+    iv->step = d->args[0];
+  else if (d->rel == MINUS && d->args[0] == v && loopConst(l, d->args[1]))
+    iv->step = d->args[1];
+  else
+    return FALSE;
+  return TRUE;
+}
+
+/* Function isInc tells whether in computes the
+ * next value of a phi of the header of l
+ */
+static int isInc(Loop *l, IrInstr *in)
+{
+  IrInstr *phi;
+  int k;
+  for (phi = l->header->first; phi != NULL && phi->op == IrPhi; phi = phi->next)
+    for (k = 0; k < phi->nargs; k++)
+      if (phi->args[k] == in->dst)
+        return TRUE;
+  return FALSE;
+}
+
+/* Function operandOf tells whether in, in loop l,
+ * computes iv * c, iv + c or iv - c of induction
+ * variable iv and loop constant c, and returns c
+ */
+static int operandOf(Loop *l, IrInstr *in, Iv *iv, int *c)
+{
+  if (in->op != IrBin || in->nargs != 2 || !l->body[in->block->id] || isInc(l, in))
+    return FALSE;
+  if (in->rel != TIMES && in->rel != PLUS && in->rel != MINUS)
+    return FALSE;
+  if (in->args[0] == iv->phi->dst && loopConst(l, in->args[1]))
+    *c = in->args[1];
+  else if (in->args[1] == iv->phi->dst && in->rel != MINUS && loopConst(l, in->args[0]))
+    *c = in->args[0];
+  else
+    return FALSE;
+  return TRUE;
+}
+
+/* Function isTest tells whether in is a branch of
+ * loop l comparing induction variable iv with a
+ * loop constant
+ */
+static int isTest(Loop *l, IrInstr *in, Iv *iv)
+{
+  if (in->op != IrBranch || in->nargs != 2 || !l->body[in->block->id])
+    return FALSE;
+  return (in->args[0] == iv->phi->dst && loopConst(l, in->args[1])) ||
+         (in->args[1] == iv->phi->dst && loopConst(l, in->args[0]));
+}
+
+/* Procedure replaceUses makes every instruction
+ * reading vreg from read vreg to instead
+ */
+static void replaceUses(int from, int to)
+{
+  IrInstr *in;
+  int i, k;
+  for (i = 0; i < fn->nblocks; i++)
+    for (in = fn->blocks[i]->first; in != NULL; in = in->next)
+      for (k = 0; k < in->nargs; k++)
+        if (in->args[k] == from)
+          in->args[k] = to;
+}
+
+/* Function testable tells whether the tests of
+ * iv can move to the result of in, an operation
+ * on iv and loop constant c: a sum, or a product
+ * by a positive constant
+ */
+static int testable(IrInstr *in, int c)
+{
+  int cv;
+  return in->rel != TIMES || (constOf(c, &cv) && cv > 0);
+}
+
+/* Function replaceable tells whether the only
+ * reads of iv and of its next value are its own
+ * increment, the operations reduce can replace
+ * and the tests of the loop, one of those
+ * operations taking the tests, so that iv is
+ * dead once they are rewritten
+ */
+static int replaceable(Loop *l, Iv *iv)
+{
+  IrInstr *in;
+  int i, k, c, tests = FALSE, target = FALSE;
+  for (i = 0; i < fn->nblocks; i++)
+    for (in = fn->blocks[i]->first; in != NULL; in = in->next)
+      for (k = 0; k < in->nargs; k++)
+        if (in->args[k] == iv->phi->dst && in != iv->inc)
+        {
+          if (operandOf(l, in, iv, &c))
+            target = target || testable(in, c);
+          else if (isTest(l, in, iv))
+            tests = TRUE;
+          else
+            return FALSE;
+        }
+        else if (in->args[k] == iv->inc->dst && in != iv->phi)
+          return FALSE;
+  return target || !tests;
+}
+
+/* Function newIv makes a new induction variable
+ * of l starting at init and going the way of iv
+ * by step, and returns its vreg
+ */
+static int newIv(Loop *l, Iv *iv, int init, int step)
+{
+  IrInstr *phi;
+  Iv other;
+  int j;
+  for (phi = l->header->first; phi != NULL && phi->op == IrPhi; phi = phi->next)
+    if (ivOf(l, phi->dst, &other) && other.rel == iv->rel && same(other.init, init) &&
+        same(other.step, step))
+      return phi->dst;
+  j = irNewVreg(fn, NULL);
+  phi = irNew(IrPhi, j, 2);
+  phi->from = (IrBlock **)malloc(2 * sizeof(IrBlock *));
+  phi->args[0] = init;
+  phi->from[0] = l->pre;
+  irInsertBefore(l->header, l->header->first, phi);
+  setDef(j, phi);
+  phi->args[1] = emitBin(iv->inc->block, iv->inc->next, iv->rel, j, step);
+  phi->from[1] = l->latch;
+  return j;
+}
+
+/* Procedure reduce strength-reduces the
+ * induction variables of l: each product of one
+ * by a loop constant becomes an induction
+ * variable of its own, stepping by the product
+ * of the step. When all an induction variable
+ * is still read by is sums with loop constants
+ * and tests, the sums become induction variables
+ * too and the tests move to one of them, so
+ * that it dies; that assumes the values do not
+ * overflow, as the array indices they count do
+ * not
+ */
+static void reduce(Loop *l)
+{
+  IrBlock *pre = l->pre;
+  IrInstr *in, *next, *test;
+  Iv *work, iv;
+  int nwork = 0, cap = 16, i, k, c, j, all, lim, step;
+  int lftr, lftrC = -1;
+  TokenType lftrRel = PLUS;
+  if (l->latch == NULL)
+    return;
+  work = (Iv *)malloc(cap * sizeof(Iv));
+  for (in = l->header->first; in != NULL && in->op == IrPhi; in = in->next)
+  {
+    if (nwork == cap)
+      work = (Iv *)realloc(work, (cap *= 2) * sizeof(Iv));
+    if (ivOf(l, in->dst, &work[nwork]))
+      nwork++;
+  }
+  while (nwork > 0)
+  {
+    iv = work[--nwork];
+    all = replaceable(l, &iv);
+    lftr = -1;
+    for (i = 0; i < fn->nblocks; i++)
+      if (l->body[i])
+        for (in = fn->blocks[i]->first; in != NULL; in = next)
+        {
+          next = in->next;
+          if (!operandOf(l, in, &iv, &c) || (in->rel != TIMES && !all))
+            continue;
+          c = outside(l, c);
+          step = outside(l, iv.step);
+          if (in->rel == TIMES)
+            j = newIv(l, &iv, emitBin(pre, pre->last, TIMES, iv.init, c),
+                      emitBin(pre, pre->last, TIMES, step, c));
+          else
+            j = newIv(l, &iv, emitBin(pre, pre->last, in->rel, iv.init, c), step);
+          if (lftr < 0 && testable(in, c))
+          {
+            lftr = j;
+            lftrRel = in->rel;
+            lftrC = c;
+          }
+          if (nwork == cap)
+            work = (Iv *)realloc(work, (cap *= 2) * sizeof(Iv));
+          if (ivOf(l, j, &work[nwork]))
+            nwork++;
+          replaceUses(in->dst, j);
+          def[in->dst] = NULL;
+          irDelete(in);
+          nreduced++;
+        }
+    /* linear function test replacement */
+    for (i = 0; i < fn->nblocks; i++)
+      if (l->body[i] && lftr >= 0 && all)
+      {
+        test = fn->blocks[i]->last;
+        if (test == NULL || !isTest(l, test, &iv))
+          continue;
+        k = test->args[0] == iv.phi->dst ? 0 : 1;
+        lim = emitBin(pre, pre->last, lftrRel, outside(l, test->args[1 - k]), lftrC);
+        test->args[k] = lftr;
+        test->args[1 - k] = lim;
+      }
+  }
+  free(work);
+}
+
+/* Procedure irLoopOpt optimizes the loops of f
+ * from the innermost out, so that what is
+ * hoisted out of an inner loop can be hoisted or
+ * reduced in the loop around it
+ */
+void irLoopOpt(IrFunc *f)
+{
+  int i;
+  fn = f;
+  irCFG(f);
+  findLoops();
+  if (makePreheaders())
+  {
+    irCFG(f);
+    findLoops();
+  }
+  findDefs();
+  for (i = 0; i < nloops; i++)
+  {
+    if (loops[i].pre == NULL)
+      continue;
+    if (HoistInvariants)
+      hoist(&loops[i]);
+    if (StrengthReduce)
+      reduce(&loops[i]);
+  }
+  freeLoops();
+  free(def);
+  def = NULL;
+  defCap = 0;
+}
+
+/* Procedure printLoopStats prints to out what
+ * irLoopOpt did so far
+ */
+void printLoopStats(FILE *out)
+{
+  fprintf(out, "    %-16s %6ld\n", "hoisted", nhoisted);
+  fprintf(out, "    %-16s %6ld\n", "reduced", nreduced);
+}
@@ -0,0 +1,27 @@
+/****************************************************/
+/* File: loop.h                                     */
+/* Loop optimizations over the SSA form of the IR   */
+/* of the C-Minus compiler                          */
+/****************************************************/
+
+#ifndef _LOOP_H_
+#define _LOOP_H_
+
+#include "ir.h"
+
+/* Procedure irLoopOpt moves the computations
+ * that do not change in a loop of f to its
+ * preheader and turns the multiplications of an
+ * induction variable by a loop constant into
+ * additions, doing away with the induction
+ * variables left only counting. f must be in
+ * SSA form
+ */
+void irLoopOpt(IrFunc *f);
+
+/* Procedure printLoopStats prints to out what
+ * irLoopOpt did so far
+ */
+void printLoopStats(FILE *out);
+
+#endif
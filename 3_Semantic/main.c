@@ -5,6 +5,7 @@
 /* Kenneth C. Louden                                */
 /****************************************************/
 
+#include <time.h>
 #include "globals.h"
 
 /* set NO_PARSE to TRUE to get a scanner-only compiler */
@@ -24,14 +25,22 @@
 #include "parse.h"
 #if !NO_ANALYZE
 #include "analyze.h"
+#include "symtab.h"
+#include "diag.h"
+#include "callgraph.h"
 #if !NO_CODE
+#include "prune.h"
+#include "code.h"
+#include "peep.h"
 #include "cgen.h"
+#include "opt.h"
 #endif
 #endif
 #endif
 
 /* allocate global variables */
 int lineno = 0;
+int colno = 0;
 FILE *source;
 FILE *listing;
 FILE *code;
@@ -43,18 +52,244 @@ int TraceParse = FALSE;
 int TraceAnalyze = FALSE;
 int TraceCode = FALSE;
 
+/* allocate and set option flags */
+int ShadowScopes = FALSE;
+
+/* kinds of symbol table dump requested on the command line */
+typedef enum
+{
+  NoDump,
+  TextDump,
+  JSONDump
+} DumpKind;
+
 int Error = FALSE;
 
+/* wall time and work of a compiler phase,
+ * reported by -ftime-report
+ */
+typedef struct
+{
+  char *name;
+  double ms;
+  long nodes;          /* tree nodes created or visited */
+  LookupStats lookups; /* symbol table work */
+} PhaseTime;
+
+#define MAXPHASES 8
+static PhaseTime phases[MAXPHASES];
+static int nphases = 0;
+
+/* the phase being timed */
+static double phaseStart;
+static long phaseNodes;
+static LookupStats phaseLookups;
+
+static double wallMs(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+/* Procedure beginPhase starts timing a phase;
+ * nodes is the current value of the node
+ * counter the phase advances
+ */
+static void beginPhase(long nodes)
+{
+  phaseNodes = nodes;
+  st_getLookupStats(&phaseLookups);
+  phaseStart = wallMs();
+}
+
+/* Procedure endPhase records the phase begun
+ * last under name
+ */
+static void endPhase(char *name, long nodes)
+{
+  PhaseTime *p;
+  LookupStats now;
+  double end = wallMs();
+  if (nphases == MAXPHASES)
+    return;
+  p = &phases[nphases++];
+  st_getLookupStats(&now);
+  p->name = name;
+  p->ms = end - phaseStart;
+  p->nodes = nodes - phaseNodes;
+  p->lookups.lookups = now.lookups - phaseLookups.lookups;
+  p->lookups.hops = now.hops - phaseLookups.hops;
+  p->lookups.scopes = now.scopes - phaseLookups.scopes;
+}
+
+/* Procedure printTimeReport prints the recorded
+ * phases to the listing file, with the number of
+ * functions dropped as unreachable, of nodes
+ * pruned before code generation, of memory
+ * operations saved by register allocation and of
+ * instructions removed by the peephole optimizer
+ */
+static void printTimeReport(int dropped, int pruned, long memSaved, int peeped)
+{
+  PhaseTime total;
+  int i;
+  memset(&total, 0, sizeof(total));
+  fprintf(listing, "\nTime report:\n");
+  fprintf(listing, "  %-12s %10s %10s %10s %10s %10s\n",
+          "phase", "wall ms", "nodes", "st_lookup", "hops", "scopes");
+  for (i = 0; i < nphases; i++)
+  {
+    PhaseTime *p = &phases[i];
+    fprintf(listing, "  %-12s %10.3f %10ld %10ld %10ld %10ld\n", p->name, p->ms,
+            p->nodes, p->lookups.lookups, p->lookups.hops, p->lookups.scopes);
+    total.ms += p->ms;
+    total.lookups.lookups += p->lookups.lookups;
+    total.lookups.hops += p->lookups.hops;
+    total.lookups.scopes += p->lookups.scopes;
+  }
+  fprintf(listing, "  %-12s %10.3f %10s %10ld %10ld %10ld\n", "total", total.ms, "",
+          total.lookups.lookups, total.lookups.hops, total.lookups.scopes);
+  fprintf(listing, "  unreachable: %d functions eliminated\n", dropped);
+  fprintf(listing, "  dead code: %d nodes eliminated\n", pruned);
+  fprintf(listing, "  registers: %ld memory operations removed\n", memSaved);
+  fprintf(listing, "  peephole: %d instructions removed\n", peeped);
+  printPeepholeStats(listing);
+  if (Optimize)
+    printOptStats(listing);
+}
+
+/* Function isNumber tells whether s is a
+ * non-empty string of decimal digits
+ */
+static int isNumber(char *s)
+{
+  if (*s == '\0')
+    return FALSE;
+  for (; *s != '\0'; s++)
+    if (!isdigit((unsigned char)*s))
+      return FALSE;
+  return TRUE;
+}
+
+static void usage(char *prog)
+{
+  fprintf(stderr, "usage: %s [options] <filename>\n", prog);
+  fprintf(stderr, "options:\n");
+  fprintf(stderr, "  --scopes=chain|shadow  symbol table lookup engine (default chain)\n");
+  fprintf(stderr, "  --dump-symtab[=json]   print the symbol table after analysis\n");
+  fprintf(stderr, "  --symtab-stats         print symbol table statistics after analysis\n");
+  fprintf(stderr, "  --two-pass             build the symbol table and type check in separate passes\n");
+  fprintf(stderr, "  --jobs=N               type check function bodies on N threads (implies --two-pass)\n");
+  fprintf(stderr, "  --incremental=FILE     only re-check functions changed since the cache FILE (implies --two-pass)\n");
+  fprintf(stderr, "  --skip-unreachable     do not type check functions unreachable from main (implies --two-pass)\n");
+  fprintf(stderr, "  --max-errors=N         report at most N semantic errors\n");
+  fprintf(stderr, "  --diagnostics=json     report semantic errors as JSON\n");
+  fprintf(stderr, "  --emit=tm|tmb          write TM text (default) or binary code\n");
+  fprintf(stderr, "  -fno-regalloc          keep all temporaries in memory\n");
+  fprintf(stderr, "  -fno-peephole          do not run the peephole optimizer\n");
+  fprintf(stderr, "  -fir                   generate code by way of the three-address IR\n");
+  fprintf(stderr, "  -O                     optimize the SSA form of the IR (implies -fir)\n");
+  fprintf(stderr, "  -fno-gvn               do not run global value numbering under -O\n");
+  fprintf(stderr, "  -fno-sccp              do not run constant propagation under -O\n");
+  fprintf(stderr, "  -fno-licm              do not hoist loop invariants under -O\n");
+  fprintf(stderr, "  -fno-ivsr              do not strength-reduce induction variables under -O\n");
+  fprintf(stderr, "  -fno-inline            do not inline small functions under -O\n");
+  fprintf(stderr, "  -finline-limit=N       inline functions of at most N nodes (default 40)\n");
+  fprintf(stderr, "  -finline-growth=N      inline at most N nodes into a function (default 200)\n");
+  fprintf(stderr, "  --dump-ir              print the IR of each function (implies -fir)\n");
+  fprintf(stderr, "  -ftime-report          print the time and work of each compiler phase\n");
+  exit(1);
+}
+
 int main(int argc, char *argv[])
 {
   TreeNode *syntaxTree;
   char pgm[120]; /* source code file name */
-  if (argc != 2)
+  char *file = NULL;
+  DumpKind dumpSymtab = NoDump;
+  int symtabStats = FALSE;
+  int twoPass = FALSE;
+  int jobs = 1;
+  int timeReport = FALSE;
+  int skipUnreachable = FALSE;
+  int dropped = 0;
+  int pruned = 0;
+  long memSaved = 0;
+  int peeped = 0;
+  char *cacheFile = NULL;
+  int i;
+  for (i = 1; i < argc; i++)
   {
-    fprintf(stderr, "usage: %s <filename>\n", argv[0]);
-    exit(1);
+    if (strcmp(argv[i], "--scopes=chain") == 0)
+      ShadowScopes = FALSE;
+    else if (strcmp(argv[i], "--scopes=shadow") == 0)
+      ShadowScopes = TRUE;
+    else if (strcmp(argv[i], "--dump-symtab") == 0 ||
+             strcmp(argv[i], "--dump-symtab=text") == 0)
+      dumpSymtab = TextDump;
+    else if (strcmp(argv[i], "--dump-symtab=json") == 0)
+      dumpSymtab = JSONDump;
+    else if (strcmp(argv[i], "--symtab-stats") == 0)
+      symtabStats = TRUE;
+    else if (strcmp(argv[i], "--two-pass") == 0)
+      twoPass = TRUE;
+    else if (strncmp(argv[i], "--jobs=", 7) == 0 && atoi(argv[i] + 7) > 0)
+    {
+      jobs = atoi(argv[i] + 7);
+      twoPass = jobs > 1 || twoPass;
+    }
+    else if (strncmp(argv[i], "--incremental=", 14) == 0 && argv[i][14] != '\0')
+    {
+      cacheFile = argv[i] + 14;
+      twoPass = TRUE;
+    }
+    else if (strcmp(argv[i], "--skip-unreachable") == 0)
+      skipUnreachable = twoPass = TRUE;
+    else if (strncmp(argv[i], "--max-errors=", 13) == 0 && isNumber(argv[i] + 13))
+      MaxErrors = atoi(argv[i] + 13);
+    else if (strcmp(argv[i], "--diagnostics=json") == 0)
+      DiagMode = DiagJSON;
+    else if (strcmp(argv[i], "--diagnostics=text") == 0)
+      DiagMode = DiagText;
+    else if (strcmp(argv[i], "--emit=tm") == 0)
+      CodeMode = TextCode;
+    else if (strcmp(argv[i], "--emit=tmb") == 0)
+      CodeMode = BinaryCode;
+    else if (strcmp(argv[i], "-fno-regalloc") == 0)
+      RegAlloc = FALSE;
+    else if (strcmp(argv[i], "-fno-peephole") == 0)
+      Peephole = FALSE;
+    else if (strcmp(argv[i], "-fir") == 0)
+      UseIR = TRUE;
+    else if (strcmp(argv[i], "-O") == 0)
+      UseIR = Optimize = TRUE;
+    else if (strcmp(argv[i], "-fno-gvn") == 0)
+      ValueNumbering = FALSE;
+    else if (strcmp(argv[i], "-fno-sccp") == 0)
+      ConstProp = FALSE;
+    else if (strcmp(argv[i], "-fno-licm") == 0)
+      HoistInvariants = FALSE;
+    else if (strcmp(argv[i], "-fno-ivsr") == 0)
+      StrengthReduce = FALSE;
+    else if (strcmp(argv[i], "-fno-inline") == 0)
+      Inline = FALSE;
+    else if (strncmp(argv[i], "-finline-limit=", 15) == 0 && isdigit(argv[i][15]))
+      InlineLimit = atoi(argv[i] + 15);
+    else if (strncmp(argv[i], "-finline-growth=", 16) == 0 && isdigit(argv[i][16]))
+      InlineGrowth = atoi(argv[i] + 16);
+    else if (strcmp(argv[i], "--dump-ir") == 0)
+      UseIR = DumpIR = TRUE;
+    else if (strcmp(argv[i], "-ftime-report") == 0)
+      timeReport = TRUE;
+    else if (argv[i][0] == '-' || file != NULL)
+      usage(argv[0]);
+    else
+      file = argv[i];
   }
-  strcpy(pgm, argv[1]);
+  if (file == NULL)
+    usage(argv[0]);
+  strcpy(pgm, file);
   if (strchr(pgm, '.') == NULL)
     strcat(pgm, ".tny");
   source = fopen(pgm, "r");
@@ -69,7 +304,9 @@ int main(int argc, char *argv[])
   while (getToken() != ENDFILE)
     ;
 #else
+  beginPhase(0);
   syntaxTree = parse();
+  endPhase("parse", maxNodeId());
   if (TraceParse)
   {
     fprintf(listing, "\nSyntax tree:\n");
@@ -78,35 +315,84 @@ int main(int argc, char *argv[])
 #if !NO_ANALYZE
   if (!Error)
   {
-    if (TraceAnalyze)
-      fprintf(listing, "\nBuilding Symbol Table...\n");
-    buildSymtab(syntaxTree);
-    if (TraceAnalyze)
-      fprintf(listing, "\nChecking Types...\n");
-    typeCheck(syntaxTree);
+    beginPhase(analyzeVisits());
+    foldConstants(syntaxTree);
+    endPhase("fold", analyzeVisits());
+    if (twoPass)
+    {
+      if (TraceAnalyze)
+        fprintf(listing, "\nBuilding Symbol Table...\n");
+      beginPhase(analyzeVisits());
+      buildSymtab(syntaxTree);
+      endPhase("buildSymtab", analyzeVisits());
+      if (skipUnreachable)
+      {
+        beginPhase(0);
+        dropped = dropUnreachable(&syntaxTree);
+        endPhase("callgraph", 0);
+      }
+      if (TraceAnalyze)
+        fprintf(listing, "\nChecking Types...\n");
+      beginPhase(analyzeVisits());
+      if (cacheFile != NULL)
+        incrementalTypeCheck(syntaxTree, cacheFile, jobs);
+      else
+        parallelTypeCheck(syntaxTree, jobs);
+      endPhase("typeCheck", analyzeVisits());
+    }
+    else
+    {
+      if (TraceAnalyze)
+        fprintf(listing, "\nBuilding Symbol Table and Checking Types...\n");
+      beginPhase(analyzeVisits());
+      analyze(syntaxTree);
+      endPhase("analyze", analyzeVisits());
+    }
+    diagFlush(listing);
     if (TraceAnalyze)
       fprintf(listing, "\nType Checking Finished\n");
+    if (dumpSymtab == TextDump)
+      printSymTab(listing);
+    else if (dumpSymtab == JSONDump)
+      printSymTabJSON(listing);
+    if (symtabStats)
+      printSymTabStats(listing);
   }
 #if !NO_CODE
   if (!Error)
   {
     char *codefile;
     int fnlen = strcspn(pgm, ".");
-    codefile = (char *)calloc(fnlen + 4, sizeof(char));
+    codefile = (char *)calloc(fnlen + 5, sizeof(char));
     strncpy(codefile, pgm, fnlen);
-    strcat(codefile, ".tm");
-    code = fopen(codefile, "w");
+    strcat(codefile, CodeMode == BinaryCode ? ".tmb" : ".tm");
+    code = fopen(codefile, CodeMode == BinaryCode ? "wb" : "w");
     if (code == NULL)
     {
       printf("Unable to open %s\n", codefile);
       exit(1);
     }
+    if (!skipUnreachable)
+    {
+      beginPhase(0);
+      dropped = dropUnreachable(&syntaxTree);
+      endPhase("callgraph", 0);
+    }
+    beginPhase(0);
+    pruned = pruneTree(syntaxTree);
+    endPhase("prune", 0);
+    beginPhase(codeGenVisits());
     codeGen(syntaxTree, codefile);
+    endPhase("codeGen", codeGenVisits());
+    memSaved = codeGenMemSaved();
+    peeped = peepholeRemoved();
     fclose(code);
   }
 #endif
 #endif
 #endif
+  if (timeReport)
+    printTimeReport(dropped, pruned, memSaved, peeped);
   fclose(source);
   return 0;
 }
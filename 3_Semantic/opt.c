@@ -0,0 +1,920 @@
+/****************************************************/
+/* File: opt.c                                      */
+/* Optimizer over the SSA form of the IR of the     */
+/* C-Minus compiler: sparse conditional constant    */
+/* propagation, global value numbering and dead     */
+/* code elimination                                 */
+/****************************************************/
+
+#include <limits.h>
+#include "globals.h"
+#include "symtab.h"
+#include "ir.h"
+#include "ssa.h"
+#include "opt.h"
+#include "loop.h"
+#include "inline.h"
+
+int Optimize = FALSE;
+int ValueNumbering = TRUE;
+int ConstProp = TRUE;
+
+/* the function being optimized */
+static IrFunc *fn;
+
+/* what irOptimize did so far */
+static long nconst = 0, nbranch = 0, nredundant = 0, ndead = 0;
+
+/* def[v] is the instruction assigning vreg v,
+ * found by findDefs
+ */
+static IrInstr **def;
+
+static int isPure(IrInstr *in)
+{
+  switch (in->op)
+  {
+  case IrConst:
+  case IrCopy:
+  case IrBin:
+  case IrParam:
+  case IrLoad:
+  case IrAddr:
+  case IrLoadElem:
+  case IrPhi:
+    return TRUE;
+  default:
+    return FALSE;
+  }
+}
+
+static void findDefs(void)
+{
+  IrInstr *in;
+  int i;
+  free(def);
+  def = (IrInstr **)calloc(fn->nvregs, sizeof(IrInstr *));
+  for (i = 0; i < fn->nblocks; i++)
+    for (in = fn->blocks[i]->first; in != NULL; in = in->next)
+      if (in->dst >= 0)
+        def[in->dst] = in;
+}
+
+/* Function constOf tells whether vreg v is
+ * assigned a constant, which it stores in *val
+ */
+static int constOf(int v, int *val)
+{
+  if (def[v] == NULL || def[v]->op != IrConst)
+    return FALSE;
+  *val = def[v]->imm;
+  return TRUE;
+}
+
+/* Function fold computes a rel b into *v the way
+ * analyze folds constant operations; it fails
+ * where the TM would stop or trap
+ */
+static int fold(TokenType rel, int a, int b, int *v)
+{
+  switch (rel)
+  {
+  /* the TM wraps around like unsigned arithmetic */
+  case PLUS:
+    *v = (int)((unsigned)a + (unsigned)b);
+    break;
+  case MINUS:
+    *v = (int)((unsigned)a - (unsigned)b);
+    break;
+  case TIMES:
+    *v = (int)((unsigned)a * (unsigned)b);
+    break;
+  case OVER:
+    if (b == 0 || (a == INT_MIN && b == -1))
+      return FALSE;
+    *v = a / b;
+    break;
+  case LT:
+    *v = a < b;
+    break;
+  case LE:
+    *v = a <= b;
+    break;
+  case GT:
+    *v = a > b;
+    break;
+  case GE:
+    *v = a >= b;
+    break;
+  case EQ:
+    *v = a == b;
+    break;
+  case NE:
+    *v = a != b;
+    break;
+  default:
+    return FALSE;
+  }
+  return TRUE;
+}
+
+static void makeConst(IrInstr *in, int v)
+{
+  in->op = IrConst;
+  in->nargs = 0;
+  in->imm = v;
+  free(in->from);
+  in->from = NULL;
+}
+
+/* Procedure makeJump turns branch in into a jump
+ * to target[0] if taken, else to target[1]
+ */
+static void makeJump(IrInstr *in, int taken)
+{
+  in->target[0] = in->target[taken ? 0 : 1];
+  in->target[1] = NULL;
+  in->op = IrJump;
+  in->nargs = 0;
+}
+
+/***********************************************/
+/* sparse conditional constant propagation     */
+/***********************************************/
+
+/* the lattice of values: kind[v] is TOP while
+ * no assignment of v is known to run, CONST
+ * while all that run assign value[v], BOTTOM
+ * after that
+ */
+#define TOP 0
+#define CONST 1
+#define BOTTOM 2
+
+static char *kind;
+static int *value;
+
+/* blockExec[b] is set once block b is known to
+ * run, edgeExec[b][i] once the edge from its
+ * predecessor i is
+ */
+static char *blockExec;
+static char **edgeExec;
+
+/* the work lists: edges newly executable and
+ * vregs whose value went down
+ */
+static IrBlock **edgeFrom, **edgeTo;
+static int nedges, edgeCap;
+static int *ssaWork;
+static int nssa;
+
+/* the instructions reading vreg v are
+ * useList[useStart[v] .. useStart[v+1]-1]
+ */
+static int *useStart;
+static IrInstr **useList;
+
+static void findUses(void)
+{
+  IrInstr *in;
+  int i, j, *fill;
+  useStart = (int *)calloc(fn->nvregs + 1, sizeof(int));
+  for (i = 0; i < fn->nblocks; i++)
+    for (in = fn->blocks[i]->first; in != NULL; in = in->next)
+      for (j = 0; j < in->nargs; j++)
+        useStart[in->args[j] + 1]++;
+  for (i = 0; i < fn->nvregs; i++)
+    useStart[i + 1] += useStart[i];
+  useList = (IrInstr **)malloc((useStart[fn->nvregs] + 1) * sizeof(IrInstr *));
+  fill = (int *)malloc(fn->nvregs * sizeof(int));
+  memcpy(fill, useStart, fn->nvregs * sizeof(int));
+  for (i = 0; i < fn->nblocks; i++)
+    for (in = fn->blocks[i]->first; in != NULL; in = in->next)
+      for (j = 0; j < in->nargs; j++)
+        useList[fill[in->args[j]]++] = in;
+  free(fill);
+}
+
+/* Procedure setValue lowers the value of v to
+ * the meet of its value and (k, val)
+ */
+static void setValue(int v, int k, int val)
+{
+  if (k == TOP || kind[v] == BOTTOM)
+    return;
+  if (kind[v] == CONST && (k == BOTTOM || value[v] != val))
+    k = BOTTOM;
+  else if (kind[v] == CONST)
+    return;
+  kind[v] = k;
+  value[v] = val;
+  ssaWork[nssa++] = v;
+}
+
+static void addEdge(IrBlock *from, IrBlock *to)
+{
+  if (nedges == edgeCap)
+  {
+    edgeCap = edgeCap ? 2 * edgeCap : 32;
+    edgeFrom = (IrBlock **)realloc(edgeFrom, edgeCap * sizeof(IrBlock *));
+    edgeTo = (IrBlock **)realloc(edgeTo, edgeCap * sizeof(IrBlock *));
+  }
+  edgeFrom[nedges] = from;
+  edgeTo[nedges++] = to;
+}
+
+static int isExecEdge(IrBlock *from, IrBlock *to)
+{
+  int i;
+  for (i = 0; i < to->npred; i++)
+    if (to->pred[i] == from)
+      return edgeExec[to->id][i];
+  return FALSE;
+}
+
+/* Function operand gives the lattice value of
+ * operand i of in, or of its immediate
+ */
+static int operand(IrInstr *in, int i, int *val)
+{
+  if (i >= in->nargs)
+  {
+    *val = in->imm;
+    return CONST;
+  }
+  *val = value[in->args[i]];
+  return kind[in->args[i]];
+}
+
+/* Procedure visit evaluates in over the lattice */
+static void visit(IrInstr *in)
+{
+  int ka, kb, a, b, v, i;
+  switch (in->op)
+  {
+  case IrConst:
+    setValue(in->dst, CONST, in->imm);
+    break;
+  case IrCopy:
+    setValue(in->dst, kind[in->args[0]], value[in->args[0]]);
+    break;
+  case IrBin:
+    ka = operand(in, 0, &a);
+    kb = operand(in, 1, &b);
+    if (ka == BOTTOM || kb == BOTTOM)
+      setValue(in->dst, BOTTOM, 0);
+    else if (ka == CONST && kb == CONST)
+    {
+      if (fold(in->rel, a, b, &v))
+        setValue(in->dst, CONST, v);
+      else
+        setValue(in->dst, BOTTOM, 0);
+    }
+    break;
+  case IrPhi:
+    for (i = 0; i < in->nargs; i++)
+      if (isExecEdge(in->from[i], in->block))
+        setValue(in->dst, kind[in->args[i]], value[in->args[i]]);
+    break;
+  case IrJump:
+    addEdge(in->block, in->target[0]);
+    break;
+  case IrBranch:
+    ka = operand(in, 0, &a);
+    kb = operand(in, 1, &b);
+    if (ka == BOTTOM || kb == BOTTOM)
+    {
+      addEdge(in->block, in->target[0]);
+      addEdge(in->block, in->target[1]);
+    }
+    else if (ka == CONST && kb == CONST)
+    {
+      fold(in->rel, a, b, &v);
+      addEdge(in->block, in->target[v ? 0 : 1]);
+    }
+    break;
+  default:
+    if (in->dst >= 0)
+      setValue(in->dst, BOTTOM, 0);
+    break;
+  }
+}
+
+/* Procedure sccp finds the vregs that hold one
+ * constant on every path that can run and the
+ * branches that always go the same way
+ * (Wegman and Zadeck), and rewrites them
+ */
+static void sccp(void)
+{
+  IrBlock *b, *from;
+  IrInstr *in, *next, *pos;
+  int i, j, v, a, c;
+  int n = fn->nblocks;
+  kind = (char *)calloc(fn->nvregs, sizeof(char));
+  value = (int *)calloc(fn->nvregs, sizeof(int));
+  blockExec = (char *)calloc(n, sizeof(char));
+  edgeExec = (char **)malloc(n * sizeof(char *));
+  for (i = 0; i < n; i++)
+    edgeExec[i] = (char *)calloc(fn->blocks[i]->npred + 1, sizeof(char));
+  ssaWork = (int *)malloc((2 * fn->nvregs + 1) * sizeof(int));
+  nssa = nedges = 0;
+  findUses();
+
+  blockExec[0] = TRUE;
+  for (in = fn->blocks[0]->first; in != NULL; in = in->next)
+    visit(in);
+  while (nedges > 0 || nssa > 0)
+  {
+    if (nedges > 0)
+    {
+      nedges--;
+      from = edgeFrom[nedges];
+      b = edgeTo[nedges];
+      for (i = 0; b->pred[i] != from; i++)
+        ;
+      if (edgeExec[b->id][i])
+        continue;
+      edgeExec[b->id][i] = TRUE;
+      for (in = b->first; in != NULL && (!blockExec[b->id] || in->op == IrPhi); in = in->next)
+        visit(in);
+      blockExec[b->id] = TRUE;
+    }
+    else
+    {
+      v = ssaWork[--nssa];
+      for (j = useStart[v]; j < useStart[v + 1]; j++)
+        if (blockExec[useList[j]->block->id])
+          visit(useList[j]);
+    }
+  }
+
+  for (i = 0; i < n; i++)
+  {
+    if (!blockExec[i])
+      continue;
+    b = fn->blocks[i];
+    for (in = b->first; in != NULL; in = next)
+    {
+      next = in->next;
+      if (in->dst >= 0 && in->op != IrConst && kind[in->dst] == CONST)
+      {
+        if (in->op == IrPhi)
+        {
+          /* the phis stay first in the block */
+          irRemove(in);
+          for (pos = b->first; pos != NULL && pos->op == IrPhi; pos = pos->next)
+            ;
+          irInsertBefore(b, pos, in);
+        }
+        makeConst(in, value[in->dst]);
+        nconst++;
+      }
+      else if (in->op == IrBranch && operand(in, 0, &a) == CONST &&
+               operand(in, 1, &c) == CONST && fold(in->rel, a, c, &v))
+      {
+        makeJump(in, v);
+        nbranch++;
+      }
+    }
+  }
+  irCFG(fn);
+
+  for (i = 0; i < n; i++)
+    free(edgeExec[i]);
+  free(edgeExec);
+  free(kind);
+  free(value);
+  free(blockExec);
+  free(ssaWork);
+  free(useStart);
+  free(useList);
+  free(edgeFrom);
+  free(edgeTo);
+  edgeFrom = edgeTo = NULL;
+  edgeCap = 0;
+}
+
+/***********************************************/
+/* global value numbering                      */
+/***********************************************/
+
+/* An expression available at the current point
+ * of the walk of the dominator tree, with the
+ * vreg holding its value. Loads are keyed by the
+ * memory state they read, renumbered after each
+ * store or call and at the start of each block
+ * but those entered only from their dominator
+ */
+typedef struct Expr
+{
+  IrOp op;
+  TokenType rel;
+  int nargs;
+  int args[2];
+  int imm;
+  BucketList sym;
+  int mem;
+  int value;
+  struct Expr *next;
+} Expr;
+
+#define HASHSIZE 211
+
+static Expr *table[HASHSIZE];
+
+/* the expressions in the order they were made
+ * available, to be withdrawn when leaving the
+ * subtree where they are
+ */
+static Expr **avail;
+static int navail, availCap;
+
+static int memState;
+
+/* leader[v] is the vreg holding the value of v */
+static int *leader;
+
+static int find(int v)
+{
+  while (leader[v] != v)
+    v = leader[v] = leader[leader[v]];
+  return v;
+}
+
+static int hashExpr(Expr *e)
+{
+  unsigned long h = e->op;
+  int i;
+  h = h * 31 + e->rel;
+  for (i = 0; i < e->nargs; i++)
+    h = h * 31 + e->args[i];
+  h = h * 31 + e->imm;
+  h = h * 31 + e->mem;
+  h = h * 31 + (unsigned long)e->sym;
+  return (int)(h % HASHSIZE);
+}
+
+static int sameExpr(Expr *a, Expr *b)
+{
+  int i;
+  if (a->op != b->op || a->rel != b->rel || a->nargs != b->nargs ||
+      a->imm != b->imm || a->sym != b->sym || a->mem != b->mem)
+    return FALSE;
+  for (i = 0; i < a->nargs; i++)
+    if (a->args[i] != b->args[i])
+      return FALSE;
+  return TRUE;
+}
+
+/* Procedure keyOf fills e in with the
+ * expression computed by in, its operands in a
+ * canonical order if rel commutes
+ */
+static void keyOf(IrInstr *in, Expr *e, int mem)
+{
+  int i, t;
+  memset(e, 0, sizeof(Expr));
+  e->op = in->op;
+  e->rel = in->rel;
+  e->nargs = in->nargs;
+  for (i = 0; i < in->nargs; i++)
+    e->args[i] = in->args[i];
+  e->imm = in->imm;
+  e->sym = in->sym;
+  e->mem = mem;
+  if (in->op == IrBin && in->nargs == 2 && e->args[0] > e->args[1] &&
+      (in->rel == PLUS || in->rel == TIMES || in->rel == EQ || in->rel == NE))
+  {
+    t = e->args[0];
+    e->args[0] = e->args[1];
+    e->args[1] = t;
+  }
+}
+
+static Expr *lookup(Expr *e)
+{
+  Expr *x;
+  for (x = table[hashExpr(e)]; x != NULL; x = x->next)
+    if (sameExpr(x, e))
+      return x;
+  return NULL;
+}
+
+static void makeAvailable(Expr *e, int value)
+{
+  Expr *x = (Expr *)malloc(sizeof(Expr));
+  int h = hashExpr(e);
+  *x = *e;
+  x->value = value;
+  x->next = table[h];
+  table[h] = x;
+  if (navail == availCap)
+  {
+    availCap = availCap ? 2 * availCap : 64;
+    avail = (Expr **)realloc(avail, availCap * sizeof(Expr *));
+  }
+  avail[navail++] = x;
+}
+
+/* Procedure replace makes v hold the value of
+ * in and deletes in
+ */
+static void replace(IrInstr *in, int v)
+{
+  leader[in->dst] = v;
+  irDelete(in);
+}
+
+/* Function simplify applies the algebraic
+ * identities of the arithmetic to in, turning it
+ * into a constant if its value is known; it
+ * returns an operand equal to in, or -1
+ */
+static int simplify(IrInstr *in)
+{
+  int x = in->args[0], y = in->args[1], a, b, ka, kb, v;
+  ka = constOf(x, &a);
+  kb = constOf(y, &b);
+  if (ka && kb && fold(in->rel, a, b, &v))
+  {
+    makeConst(in, v);
+    nconst++;
+    return -1;
+  }
+  switch (in->rel)
+  {
+  case PLUS:
+    if (kb && b == 0)
+      return x;
+    if (ka && a == 0)
+      return y;
+    break;
+  case MINUS:
+    if (kb && b == 0)
+      return x;
+    if (x == y)
+      makeConst(in, 0);
+    break;
+  case TIMES:
+    if (kb && b == 1)
+      return x;
+    if (ka && a == 1)
+      return y;
+    if ((ka && a == 0) || (kb && b == 0))
+      makeConst(in, 0);
+    break;
+  case OVER:
+    if (kb && b == 1)
+      return x;
+    break;
+  case EQ:
+  case LE:
+  case GE:
+    if (x == y)
+      makeConst(in, 1);
+    break;
+  default:
+    if (x == y)
+      makeConst(in, 0);
+    break;
+  }
+  return -1;
+}
+
+/* Procedure available replaces in by the vreg
+ * holding its value if it was computed before on
+ * every path, else records it as computed
+ */
+static void available(IrInstr *in, int mem)
+{
+  Expr e, *x;
+  keyOf(in, &e, mem);
+  if ((x = lookup(&e)) != NULL)
+  {
+    replace(in, x->value);
+    nredundant++;
+  }
+  else
+    makeAvailable(&e, in->dst);
+}
+
+/* Procedure gvnBlock numbers the values of the
+ * dominator subtree of b, entered with memory
+ * state mem
+ */
+static void gvnBlock(IrBlock *b, int mem)
+{
+  IrInstr *in, *next;
+  IrBlock *s, *c;
+  Expr e, *x;
+  int i, j, v, same, mark = navail;
+  for (in = b->first; in != NULL; in = next)
+  {
+    next = in->next;
+    for (i = 0; i < in->nargs; i++)
+      in->args[i] = find(in->args[i]);
+    switch (in->op)
+    {
+    case IrPhi:
+      v = -1;
+      same = TRUE;
+      for (i = 0; i < in->nargs; i++)
+        if (in->args[i] != in->dst)
+        {
+          if (v >= 0 && in->args[i] != v)
+            same = FALSE;
+          v = in->args[i];
+        }
+      if (same && v >= 0)
+        replace(in, v);
+      break;
+    case IrCopy:
+      replace(in, in->args[0]);
+      break;
+    case IrBin:
+      if (in->nargs == 2 && (v = simplify(in)) >= 0)
+        replace(in, v);
+      else
+        available(in, 0); /* as a constant if simplified to one */
+      break;
+    case IrConst:
+    case IrAddr:
+      /* keyed by imm and sym, so that the loads
+       * and stores of an element of a global or
+       * local array share their base
+       */
+      available(in, 0);
+      break;
+    case IrLoad:
+    case IrLoadElem:
+      available(in, mem);
+      break;
+    case IrStore:
+      /* a load of sym gets the value stored */
+      mem = ++memState;
+      memset(&e, 0, sizeof(Expr));
+      e.op = IrLoad;
+      e.sym = in->sym;
+      e.mem = mem;
+      makeAvailable(&e, in->args[0]);
+      break;
+    case IrStoreElem:
+      mem = ++memState;
+      memset(&e, 0, sizeof(Expr));
+      e.op = IrLoadElem;
+      e.nargs = 2;
+      e.args[0] = in->args[0];
+      e.args[1] = in->args[1];
+      e.mem = mem;
+      makeAvailable(&e, in->args[2]);
+      break;
+    case IrCall:
+      mem = ++memState;
+      break;
+    default:
+      break;
+    }
+  }
+  for (i = 0; i < b->nsucc; i++)
+  {
+    s = b->succ[i];
+    for (in = s->first; in != NULL && in->op == IrPhi; in = in->next)
+      for (j = 0; j < in->nargs; j++)
+        if (in->from[j] == b)
+          in->args[j] = find(in->args[j]);
+  }
+  for (c = b->domChild; c != NULL; c = c->domNext)
+    gvnBlock(c, c->npred == 1 ? mem : ++memState);
+  while (navail > mark)
+  {
+    x = avail[--navail];
+    table[hashExpr(x)] = x->next;
+    free(x);
+  }
+}
+
+/* Procedure gvn removes the computations of
+ * values already computed on every path to them,
+ * walking the dominator tree with the table of
+ * the expressions available (Briggs, Cooper and
+ * Simpson's dominator-based value numbering)
+ */
+static void gvn(void)
+{
+  int v;
+  irDominators(fn);
+  findDefs();
+  leader = (int *)malloc(fn->nvregs * sizeof(int));
+  for (v = 0; v < fn->nvregs; v++)
+    leader[v] = v;
+  gvnBlock(fn->blocks[0], ++memState);
+  free(leader);
+}
+
+/***********************************************/
+/* dead code elimination and immediates        */
+/***********************************************/
+
+/* Procedure dce removes the pure instructions
+ * whose values nothing with an effect needs
+ */
+static void dce(void)
+{
+  char *live = (char *)calloc(fn->nvregs, sizeof(char));
+  int *work = (int *)malloc((fn->nvregs + 1) * sizeof(int));
+  IrInstr *in, *next;
+  int i, j, v, nwork = 0;
+  findDefs();
+  for (i = 0; i < fn->nblocks; i++)
+    for (in = fn->blocks[i]->first; in != NULL; in = in->next)
+      if (!isPure(in))
+        for (j = 0; j < in->nargs; j++)
+          if (!live[in->args[j]])
+          {
+            live[in->args[j]] = TRUE;
+            work[nwork++] = in->args[j];
+          }
+  while (nwork > 0)
+  {
+    v = work[--nwork];
+    in = def[v];
+    if (in != NULL)
+      for (j = 0; j < in->nargs; j++)
+        if (!live[in->args[j]])
+        {
+          live[in->args[j]] = TRUE;
+          work[nwork++] = in->args[j];
+        }
+  }
+  for (i = 0; i < fn->nblocks; i++)
+    for (in = fn->blocks[i]->first; in != NULL; in = next)
+    {
+      next = in->next;
+      if (isPure(in) && !live[in->dst])
+      {
+        irDelete(in);
+        ndead++;
+      }
+    }
+  free(live);
+  free(work);
+}
+
+/* Function readFrom tells whether vreg v is a
+ * constant or address, or is read at or after
+ * instruction from in its block
+ */
+static int readFrom(int v, IrInstr *from)
+{
+  IrInstr *p;
+  int j;
+  if (def[v] != NULL && (def[v]->op == IrConst || def[v]->op == IrAddr))
+    return TRUE;
+  for (p = from; p != NULL; p = p->next)
+    for (j = 0; j < p->nargs; j++)
+      if (p->args[j] == v)
+        return TRUE;
+  return FALSE;
+}
+
+/* Procedure sink moves each pure instruction
+ * read once, further down its block, to just
+ * before the reader, so that its value holds a
+ * register for less. It does not if that keeps
+ * an operand alive for longer, and a read of
+ * memory does not move past an instruction with
+ * an effect
+ */
+static void sink(void)
+{
+  IrInstr *in, *prev, *use, *p;
+  int i, j, v;
+  findDefs();
+  findUses();
+  for (i = 0; i < fn->nblocks; i++)
+    for (in = fn->blocks[i]->last; in != NULL; in = prev)
+    {
+      prev = in->prev;
+      v = in->dst;
+      if (!isPure(in) || in->op == IrPhi || in->op == IrConst || in->op == IrAddr ||
+          useStart[v + 1] - useStart[v] != 1)
+        continue;
+      use = useList[useStart[v]];
+      if (use->block != in->block || use->op == IrPhi || use == in->next)
+        continue;
+      for (p = in->next; p != use; p = p->next)
+        if (!isPure(p) && (in->op == IrLoad || in->op == IrLoadElem || in->op == IrParam))
+          break;
+      for (j = 0; j < in->nargs && readFrom(in->args[j], use); j++)
+        ;
+      if (p != use || j < in->nargs)
+        continue;
+      irRemove(in);
+      irInsertBefore(use->block, use, in);
+    }
+  free(useStart);
+  free(useList);
+}
+
+/* Function mirror returns the relation r' with
+ * b r' a exactly when a r b, or ERROR
+ */
+static TokenType mirror(TokenType rel)
+{
+  switch (rel)
+  {
+  case PLUS:
+  case TIMES:
+  case EQ:
+  case NE:
+    return rel;
+  case LT:
+    return GT;
+  case LE:
+    return GE;
+  case GT:
+    return LT;
+  case GE:
+    return LE;
+  default:
+    return ERROR;
+  }
+}
+
+/* Procedure immediates makes the constant
+ * operands of arithmetic and branches immediates
+ * of the instruction, which the TM adds and
+ * compares with LDA
+ */
+static void immediates(void)
+{
+  IrInstr *in;
+  int i, a, b, t;
+  findDefs();
+  for (i = 0; i < fn->nblocks; i++)
+    for (in = fn->blocks[i]->first; in != NULL; in = in->next)
+    {
+      if ((in->op != IrBin && in->op != IrBranch) || in->nargs != 2)
+        continue;
+      if (constOf(in->args[0], &a) && !constOf(in->args[1], &b) &&
+          mirror(in->rel) != ERROR)
+      {
+        t = in->args[0];
+        in->args[0] = in->args[1];
+        in->args[1] = t;
+        in->rel = mirror(in->rel);
+      }
+      if (constOf(in->args[1], &b))
+      {
+        in->nargs = 1;
+        in->imm = b;
+      }
+    }
+}
+
+/* Procedure irOptimize runs the passes over the
+ * SSA form of f
+ */
+void irOptimize(IrFunc *f)
+{
+  fn = f;
+  if (Inline)
+    irInline(f);
+  irToSSA(f);
+  if (ConstProp)
+    sccp();
+  if (ValueNumbering)
+    gvn();
+  if (HoistInvariants || StrengthReduce)
+  {
+    /* the phis left dead would keep induction variables alive */
+    dce();
+    irLoopOpt(f);
+    /* merge the constants and sums the loops left in preheaders */
+    if (ValueNumbering)
+      gvn();
+  }
+  dce();
+  immediates();
+  dce();
+  sink();
+  irFromSSA(f);
+  free(def);
+  def = NULL;
+}
+
+/* Procedure printOptStats prints to out what
+ * irOptimize did so far
+ */
+void printOptStats(FILE *out)
+{
+  fprintf(out, "  ssa: %ld instructions optimized away\n", nredundant + ndead);
+  fprintf(out, "    %-16s %6ld\n", "constants", nconst);
+  fprintf(out, "    %-16s %6ld\n", "branches", nbranch);
+  fprintf(out, "    %-16s %6ld\n", "redundant", nredundant);
+  fprintf(out, "    %-16s %6ld\n", "dead", ndead);
+  printLoopStats(out);
+  printInlineStats(out);
+}
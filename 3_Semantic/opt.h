@@ -0,0 +1,55 @@
+/****************************************************/
+/* File: opt.h                                      */
+/* Optimizer over the SSA form of the IR of the     */
+/* C-Minus compiler                                 */
+/****************************************************/
+
+#ifndef _OPT_H_
+#define _OPT_H_
+
+#include "ir.h"
+
+/* Optimize = TRUE makes the code generator run
+ * irOptimize on each function lowered to the IR
+ */
+extern int Optimize;
+
+/* ValueNumbering = FALSE and ConstProp = FALSE
+ * turn off global value numbering and sparse
+ * conditional constant propagation
+ */
+extern int ValueNumbering;
+extern int ConstProp;
+
+/* HoistInvariants = FALSE and StrengthReduce =
+ * FALSE turn off loop-invariant code motion and
+ * strength reduction of induction variables
+ */
+extern int HoistInvariants;
+extern int StrengthReduce;
+
+/* Inline = FALSE turns off the inlining of small
+ * functions; InlineLimit is the most nodes the
+ * body of a function inlined may have and
+ * InlineGrowth the most nodes inlined into a
+ * function in all
+ */
+extern int Inline;
+extern int InlineLimit;
+extern int InlineGrowth;
+
+/* Procedure irOptimize inlines the small
+ * functions f calls, puts f in SSA form, folds
+ * the values and branches known to be constant,
+ * removes the computations of values already
+ * available and the ones never read, optimizes
+ * the loops and takes f out of SSA form again
+ */
+void irOptimize(IrFunc *f);
+
+/* Procedure printOptStats prints to out what
+ * irOptimize did so far
+ */
+void printOptStats(FILE *out);
+
+#endif
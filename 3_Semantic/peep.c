@@ -0,0 +1,353 @@
+/****************************************************/
+/* File: peep.c                                     */
+/* Peephole optimizer over the TM code buffer of    */
+/* the C-Minus compiler                             */
+/****************************************************/
+
+#include "globals.h"
+#include "code.h"
+#include "peep.h"
+
+int Peephole = TRUE;
+
+/* the code being optimized: buf[loc] is live
+ * unless dead[loc] is set; targets[loc] counts
+ * the pc-relative instructions that refer to loc
+ */
+static TMInstr *buf;
+static int size;
+static char *dead;
+static int *targets;
+
+/* removed counts the instructions deleted */
+static int removed = 0;
+
+/* A rule rewrites the code at loc if it matches
+ * there and returns the number of locations it
+ * covered, 0 if it does not match. Rules only
+ * change locations from loc on, so targets stays
+ * exact for the locations still to be matched
+ */
+typedef struct
+{
+  char *name;
+  int (*apply)(int loc);
+  int hits;
+} PeepRule;
+
+static int isJump(TMInstr *in)
+{
+  return in->op >= opJLT && in->op <= opJNE;
+}
+
+/* Function isGoto tells whether in is the
+ * unconditional jump LDA pc,d(pc)
+ */
+static int isGoto(TMInstr *in)
+{
+  return in->op == opLDA && in->r == pc && in->s == pc;
+}
+
+/* Function refers tells whether in holds a
+ * pc-relative code address
+ */
+static int refers(TMInstr *in)
+{
+  return in->op > opRRLim && in->op < opRALim && in->s == pc;
+}
+
+static int targetOf(int loc)
+{
+  return loc + 1 + buf[loc].d;
+}
+
+static void setTarget(int loc, int target)
+{
+  buf[loc].d = target - (loc + 1);
+}
+
+/* Function window tells whether the n locations
+ * from loc exist, are live and hold instructions
+ */
+static int window(int loc, int n)
+{
+  int i;
+  if (loc + n > size)
+    return FALSE;
+  for (i = loc; i < loc + n; i++)
+    if (dead[i] || buf[i].op < 0)
+      return FALSE;
+  return TRUE;
+}
+
+static void drop(int loc)
+{
+  dead[loc] = TRUE;
+  removed++;
+}
+
+/* Function negate returns the conditional jump
+ * taken exactly when op is not
+ */
+static int negate(int op)
+{
+  switch (op)
+  {
+  case opJLT:
+    return opJGE;
+  case opJLE:
+    return opJGT;
+  case opJGT:
+    return opJLE;
+  case opJGE:
+    return opJLT;
+  case opJEQ:
+    return opJNE;
+  default:
+    return opJEQ;
+  }
+}
+
+/* Function isCompare tells whether the code at
+ * loc is the value of a relational operator:
+ *   SUB  ac,l,r
+ *   Jcc  ac,2(pc)
+ *   LDC  ac,0
+ *   LDA  pc,1(pc)
+ *   LDC  ac,1
+ * entered only at the SUB
+ */
+static int isCompare(int loc)
+{
+  TMInstr *in = &buf[loc];
+  if (!window(loc, 5))
+    return FALSE;
+  return in[0].op == opSUB && in[0].r == ac &&
+         isJump(&in[1]) && in[1].r == ac && in[1].s == pc && in[1].d == 2 &&
+         in[2].op == opLDC && in[2].r == ac && in[2].d == 0 &&
+         isGoto(&in[3]) && in[3].d == 1 &&
+         in[4].op == opLDC && in[4].r == ac && in[4].d == 1 &&
+         targets[loc + 1] == 0 && targets[loc + 2] == 0 &&
+         targets[loc + 3] == 0 && targets[loc + 4] == 1;
+}
+
+/* rule "compare-branch": a relational value
+ * tested by JEQ (the tests of if and while)
+ * becomes one conditional jump on the
+ * difference. ac is dead where both go, at the
+ * start of a statement
+ */
+static int compareBranch(int loc)
+{
+  TMInstr *in = &buf[loc];
+  int target;
+  if (!isCompare(loc) || !window(loc + 5, 1) || targets[loc + 5] != 1 ||
+      in[5].op != opJEQ || in[5].r != ac || in[5].s != pc)
+    return 0;
+  target = targetOf(loc + 5);
+  in[1].op = negate(in[1].op);
+  in[1].comment = in[5].comment;
+  setTarget(loc + 1, target);
+  drop(loc + 2);
+  drop(loc + 3);
+  drop(loc + 4);
+  drop(loc + 5);
+  return 6;
+}
+
+/* rule "compare": the other relational values
+ * are computed without the jump over LDC ac,1:
+ *   SUB  ac1,l,r
+ *   LDC  ac,1
+ *   Jcc  ac1,1(pc)
+ *   LDC  ac,0
+ * ac1 is a scratch register at this point
+ */
+static int compare(int loc)
+{
+  TMInstr *in = &buf[loc];
+  int op;
+  if (!isCompare(loc))
+    return 0;
+  op = in[1].op;
+  in[0].r = ac1;
+  in[1] = in[4];
+  in[1].s = 0;
+  in[2].op = op;
+  in[2].r = ac1;
+  in[2].d = 1;
+  in[2].s = pc;
+  in[2].comment = "br if true";
+  in[3].op = opLDC;
+  in[3].r = ac;
+  in[3].d = 0;
+  in[3].s = 0;
+  in[3].comment = "false case";
+  drop(loc + 4);
+  return 5;
+}
+
+/* rule "jump-next": a jump to the next
+ * instruction does nothing
+ */
+static int jumpNext(int loc)
+{
+  TMInstr *in = &buf[loc];
+  if (!window(loc, 1) || !(isGoto(in) || (isJump(in) && in->s == pc)) || in->d != 0)
+    return 0;
+  targets[loc + 1]--;
+  drop(loc);
+  return 1;
+}
+
+/* rule "jump-thread": a jump to an
+ * unconditional jump goes to its target instead
+ */
+static int jumpThread(int loc)
+{
+  TMInstr *in = &buf[loc];
+  int target, next;
+  if (!window(loc, 1) || !(isGoto(in) || (isJump(in) && in->s == pc)))
+    return 0;
+  target = targetOf(loc);
+  if (target < 0 || target >= size || dead[target] || !isGoto(&buf[target]))
+    return 0;
+  next = targetOf(target);
+  if (next == target)
+    return 0;
+  targets[target]--;
+  if (next >= 0 && next <= size)
+    targets[next]++;
+  setTarget(loc, next);
+  return 1;
+}
+
+/* rule "store-load": a load of the location
+ * just stored takes the register instead
+ */
+static int storeLoad(int loc)
+{
+  TMInstr *in = &buf[loc];
+  if (!window(loc, 2) || targets[loc + 1] != 0 ||
+      in[0].op != opST || in[1].op != opLD || in[0].s == pc ||
+      in[0].d != in[1].d || in[0].s != in[1].s)
+    return 0;
+  if (in[1].r == in[0].r)
+    drop(loc + 1);
+  else
+  {
+    in[1].op = opLDA;
+    in[1].d = 0;
+    in[1].s = in[0].r;
+    in[1].comment = "copy stored value";
+  }
+  return 2;
+}
+
+/* rule "load-store": storing the value just
+ * loaded from the same location does nothing
+ */
+static int loadStore(int loc)
+{
+  TMInstr *in = &buf[loc];
+  if (!window(loc, 2) || targets[loc + 1] != 0 ||
+      in[0].op != opLD || in[1].op != opST || in[0].r == in[0].s ||
+      in[0].r != in[1].r || in[0].d != in[1].d || in[0].s != in[1].s)
+    return 0;
+  drop(loc + 1);
+  return 2;
+}
+
+/* rule "dead-load": a register loaded and then
+ * loaded again without being read loses the
+ * first load
+ */
+static int deadLoad(int loc)
+{
+  TMInstr *in = &buf[loc];
+  if (!window(loc, 2) || in[0].r == pc ||
+      (in[0].op != opLD && in[0].op != opLDA && in[0].op != opLDC) ||
+      (in[1].op != opLD && in[1].op != opLDA && in[1].op != opLDC) ||
+      in[1].r != in[0].r || (in[1].op != opLDC && in[1].s == in[0].r) ||
+      refers(&in[0]))
+    return 0;
+  drop(loc);
+  return 1;
+}
+
+/* the rules, tried in order at each location */
+static PeepRule rules[] = {
+    {"compare-branch", compareBranch, 0},
+    {"compare", compare, 0},
+    {"jump-next", jumpNext, 0},
+    {"jump-thread", jumpThread, 0},
+    {"store-load", storeLoad, 0},
+    {"load-store", loadStore, 0},
+    {"dead-load", deadLoad, 0},
+    {NULL, NULL, 0}};
+
+/* Procedure countTargets fills targets in for
+ * the live code
+ */
+static void countTargets(void)
+{
+  int loc, target;
+  memset(targets, 0, (size + 1) * sizeof(int));
+  for (loc = 0; loc < size; loc++)
+    if (!dead[loc] && buf[loc].op >= 0 && refers(&buf[loc]))
+    {
+      target = targetOf(loc);
+      if (target >= 0 && target <= size)
+        targets[target]++;
+    }
+}
+
+/* Function peephole rewrites the code emitted
+ * so far until no rule applies and returns the
+ * number of instructions removed
+ */
+int peephole(void)
+{
+  int loc, n, i, changed, before = removed;
+  do
+  {
+    buf = emitCode(&size);
+    dead = (char *)calloc(size + 1, sizeof(char));
+    targets = (int *)malloc((size + 1) * sizeof(int));
+    countTargets();
+    changed = FALSE;
+    for (loc = 0; loc < size;)
+    {
+      for (i = 0, n = 0; rules[i].name != NULL && n == 0; i++)
+        if ((n = rules[i].apply(loc)) > 0)
+        {
+          rules[i].hits++;
+          changed = TRUE;
+        }
+      loc += n > 0 ? n : 1;
+    }
+    emitCompact(dead);
+    free(dead);
+    free(targets);
+  } while (changed);
+  return removed - before;
+}
+
+/* Function peepholeRemoved returns the number of
+ * instructions removed so far
+ */
+int peepholeRemoved(void)
+{
+  return removed;
+}
+
+/* Procedure printPeepholeStats prints to out how
+ * often each rule applied
+ */
+void printPeepholeStats(FILE *out)
+{
+  int i;
+  for (i = 0; rules[i].name != NULL; i++)
+    if (rules[i].hits > 0)
+      fprintf(out, "    %-16s %6d\n", rules[i].name, rules[i].hits);
+}
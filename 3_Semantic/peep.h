@@ -0,0 +1,35 @@
+/****************************************************/
+/* File: peep.h                                     */
+/* Peephole optimizer over the TM code buffer of    */
+/* the C-Minus compiler                             */
+/****************************************************/
+
+#ifndef _PEEP_H_
+#define _PEEP_H_
+
+/* Peephole = TRUE makes codeGen run the
+ * peephole optimizer before writing the code
+ */
+extern int Peephole;
+
+/* Function peephole rewrites the instructions
+ * emitted so far with a table of patterns:
+ * relational values tested by a jump become one
+ * conditional jump, jumps to jumps are threaded,
+ * jumps to the next instruction and redundant
+ * loads and stores are removed. It returns the
+ * number of instructions removed
+ */
+int peephole(void);
+
+/* Function peepholeRemoved returns the number of
+ * instructions removed so far
+ */
+int peepholeRemoved(void);
+
+/* Procedure printPeepholeStats prints to out how
+ * often each pattern applied
+ */
+void printPeepholeStats(FILE *out);
+
+#endif
@@ -0,0 +1,75 @@
+/****************************************************/
+/* File: prelude.c                                  */
+/* Built-in functions of C-Minus, kept as an        */
+/* immutable root scope of the symbol table         */
+/****************************************************/
+
+#include "globals.h"
+#include "symtab.h"
+
+/* the prelude is the parent of the global scope.
+ * Its records are static data, so nothing is
+ * built at startup however many built-ins there
+ * are; lookups binary-search preludeSyms instead
+ * of probing the (empty) bucket array
+ */
+static struct ScopeListRec prelude = {.name = "prelude"};
+
+/* declaration trees of the built-ins, used by
+ * the CallK check for their parameter lists
+ */
+static TreeNode inputParams = {.nodekind = ExpK, .kind.exp = VoidParamK};
+static TreeNode inputDecl = {.child = {&inputParams}, .nodekind = StmtK, .kind.stmt = FunDeclK, .attr.name = "input", .type = Integer};
+
+static TreeNode outputParams = {.nodekind = ExpK, .kind.exp = ParamK, .attr.name = "value", .type = Integer};
+static TreeNode outputDecl = {.child = {&outputParams}, .nodekind = StmtK, .kind.stmt = FunDeclK, .attr.name = "output", .type = Void};
+
+static struct LineListRec builtinLine = {0, NULL};
+
+/* parameter types of the built-ins */
+static unsigned char noParams[1] = {0};
+static unsigned char intParam[1] = {Integer};
+
+/* the built-in records, sorted by name */
+#define BUILTIN(n, ty, decl, loc, nparams, params)                 \
+  {                                                                \
+    .name = n, .type = ty, .lines = &builtinLine,                  \
+    .lastLine = &builtinLine, .lineCount = 1, .memloc = loc,       \
+    .scope = &prelude, .treeNode = &decl,                          \
+    .arity = nparams, .paramTypes = params                         \
+  }
+
+static struct BucketListRec preludeSyms[] = {
+    BUILTIN("input", Integer, inputDecl, 0, 0, noParams),
+    BUILTIN("output", Void, outputDecl, 1, 1, intParam),
+};
+
+#define NPRELUDE (int)(sizeof(preludeSyms) / sizeof(preludeSyms[0]))
+
+/* Function preludeScope returns the root scope
+ * holding the built-in functions
+ */
+ScopeList preludeScope(void)
+{
+  return &prelude;
+}
+
+/* Function prelude_lookup returns the record
+ * of built-in name, or NULL if there is none
+ */
+BucketList prelude_lookup(char *name)
+{
+  int lo = 0, hi = NPRELUDE - 1;
+  while (lo <= hi)
+  {
+    int mid = (lo + hi) / 2;
+    int c = strcmp(name, preludeSyms[mid].name);
+    if (c == 0)
+      return &preludeSyms[mid];
+    if (c < 0)
+      hi = mid - 1;
+    else
+      lo = mid + 1;
+  }
+  return NULL;
+}
@@ -0,0 +1,188 @@
+/****************************************************/
+/* File: prune.c                                    */
+/* Dead code elimination on the syntax tree of      */
+/* the C-Minus compiler                             */
+/****************************************************/
+
+#include "globals.h"
+#include "symtab.h"
+#include "prune.h"
+
+/* eliminated counts the nodes removed */
+static int eliminated = 0;
+
+/* Function countNodes returns the number of
+ * nodes in t, its children and its siblings
+ */
+static int countNodes(TreeNode *t)
+{
+  int i, n = 0;
+  for (; t != NULL; t = t->sibling)
+  {
+    n++;
+    for (i = 0; i < MAXCHILDREN; i++)
+      n += countNodes(t->child[i]);
+  }
+  return n;
+}
+
+static int isConst(TreeNode *t)
+{
+  return t != NULL && t->nodekind == ExpK && t->kind.exp == ConstK;
+}
+
+/* Function fallsThrough tells whether control
+ * can reach the statement after t
+ */
+static int fallsThrough(TreeNode *t)
+{
+  if (t == NULL || t->nodekind != StmtK)
+    return TRUE;
+  switch (t->kind.stmt)
+  {
+  case ReturnK:
+    return FALSE;
+  case WhileK: /* C-Minus has no break */
+    return !isConst(t->child[0]) || t->child[0]->attr.val == 0;
+  case IfElseK:
+    return fallsThrough(t->child[1]) || fallsThrough(t->child[2]);
+  case CompK:
+    for (t = t->child[1]; t != NULL && t->sibling != NULL; t = t->sibling)
+      ;
+    return fallsThrough(t);
+  default:
+    return TRUE;
+  }
+}
+
+static TreeNode *pruneStmt(TreeNode *t);
+
+/* Function pruneList simplifies the statements
+ * of list t and drops those after one that does
+ * not fall through; it returns the new list
+ */
+static TreeNode *pruneList(TreeNode *t)
+{
+  TreeNode *head = NULL, *last = NULL;
+  while (t != NULL)
+  {
+    TreeNode *next = t->sibling;
+    t->sibling = NULL;
+    t = pruneStmt(t);
+    if (t != NULL)
+    {
+      if (last == NULL)
+        head = t;
+      else
+        last->sibling = t;
+      last = t;
+      if (!fallsThrough(t))
+      {
+        eliminated += countNodes(next);
+        break;
+      }
+    }
+    t = next;
+  }
+  return head;
+}
+
+/* Function pruneDecls drops the local variables
+ * of list t whose only line is the declaration
+ */
+static TreeNode *pruneDecls(TreeNode *t)
+{
+  TreeNode *head = NULL, *last = NULL;
+  while (t != NULL)
+  {
+    TreeNode *next = t->sibling;
+    t->sibling = NULL;
+    if (t->symbol != NULL && t->symbol->lineCount <= 1)
+      eliminated += countNodes(t);
+    else
+    {
+      if (last == NULL)
+        head = t;
+      else
+        last->sibling = t;
+      last = t;
+    }
+    t = next;
+  }
+  return head;
+}
+
+/* Function pruneBranch returns what is left of
+ * branch t of a conditional whose constant
+ * condition says whether it is taken
+ */
+static TreeNode *pruneBranch(TreeNode *t, int taken)
+{
+  if (taken)
+    return pruneStmt(t);
+  eliminated += countNodes(t);
+  return NULL;
+}
+
+/* Function pruneStmt simplifies statement t and
+ * returns the statement replacing it, NULL if
+ * nothing is left
+ */
+static TreeNode *pruneStmt(TreeNode *t)
+{
+  TreeNode *cond;
+  if (t == NULL || t->nodekind != StmtK)
+    return t;
+  cond = t->child[0];
+  switch (t->kind.stmt)
+  {
+  case CompK:
+    t->child[0] = pruneDecls(t->child[0]);
+    t->child[1] = pruneList(t->child[1]);
+    break;
+  case IfK:
+    if (isConst(cond))
+    {
+      eliminated += 2;
+      return pruneBranch(t->child[1], cond->attr.val != 0);
+    }
+    t->child[1] = pruneStmt(t->child[1]);
+    break;
+  case IfElseK:
+    if (isConst(cond))
+    {
+      eliminated += 2;
+      t->child[1] = pruneBranch(t->child[1], cond->attr.val != 0);
+      t->child[2] = pruneBranch(t->child[2], cond->attr.val == 0);
+      return t->child[1] != NULL ? t->child[1] : t->child[2];
+    }
+    t->child[1] = pruneStmt(t->child[1]);
+    t->child[2] = pruneStmt(t->child[2]);
+    break;
+  case WhileK:
+    if (isConst(cond) && cond->attr.val == 0)
+    {
+      eliminated += countNodes(t);
+      return NULL;
+    }
+    t->child[1] = pruneStmt(t->child[1]);
+    break;
+  default:
+    break;
+  }
+  return t;
+}
+
+/* Function pruneTree simplifies the function
+ * bodies of an analyzed syntax tree and returns
+ * the number of tree nodes eliminated
+ */
+int pruneTree(TreeNode *syntaxTree)
+{
+  TreeNode *t;
+  eliminated = 0;
+  for (t = syntaxTree; t != NULL; t = t->sibling)
+    if (t->nodekind == StmtK && t->kind.stmt == FunDeclK)
+      t->child[1] = pruneStmt(t->child[1]);
+  return eliminated;
+}
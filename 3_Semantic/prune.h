@@ -0,0 +1,19 @@
+/****************************************************/
+/* File: prune.h                                    */
+/* Dead code elimination on the syntax tree of      */
+/* the C-Minus compiler                             */
+/****************************************************/
+
+#ifndef _PRUNE_H_
+#define _PRUNE_H_
+
+/* Function pruneTree simplifies the function
+ * bodies of an analyzed syntax tree: statements
+ * that cannot be reached, branches and loops on
+ * constant conditions and local variables that
+ * are never used are removed. It returns the
+ * number of tree nodes eliminated
+ */
+int pruneTree(TreeNode *syntaxTree);
+
+#endif
@@ -0,0 +1,791 @@
+/****************************************************/
+/* File: ssa.c                                      */
+/* Dominators and SSA form of the IR of the         */
+/* C-Minus compiler                                 */
+/****************************************************/
+
+#include "globals.h"
+#include "symtab.h"
+#include "ir.h"
+#include "ssa.h"
+
+/* the function being transformed */
+static IrFunc *fn;
+
+/***********************************************/
+/* dominators                                  */
+/***********************************************/
+
+static void postorder(IrBlock *b, char *seen, IrBlock **list, int *n)
+{
+  int i;
+  seen[b->id] = TRUE;
+  for (i = 0; i < b->nsucc; i++)
+    if (!seen[b->succ[i]->id])
+      postorder(b->succ[i], seen, list, n);
+  list[(*n)++] = b;
+}
+
+static IrBlock *intersect(IrBlock *a, IrBlock *b)
+{
+  while (a != b)
+  {
+    while (a->order > b->order)
+      a = a->idom;
+    while (b->order > a->order)
+      b = b->idom;
+  }
+  return a;
+}
+
+/* Procedure irDominators computes the immediate
+ * dominators of f by iterating over its blocks in
+ * reverse postorder until nothing changes
+ * (Cooper, Harvey and Kennedy). f must have its
+ * edges computed by irCFG
+ */
+void irDominators(IrFunc *f)
+{
+  IrBlock **list = (IrBlock **)malloc(f->nblocks * sizeof(IrBlock *));
+  char *seen = (char *)calloc(f->nblocks, sizeof(char));
+  IrBlock *b, *idom;
+  int i, j, n = 0, changed;
+  postorder(f->blocks[0], seen, list, &n);
+  for (i = 0; i < n; i++)
+  {
+    list[i]->order = n - 1 - i;
+    list[i]->idom = NULL;
+  }
+  f->blocks[0]->idom = f->blocks[0];
+  do
+  {
+    changed = FALSE;
+    for (i = n - 2; i >= 0; i--)
+    {
+      b = list[i];
+      idom = NULL;
+      for (j = 0; j < b->npred; j++)
+        if (b->pred[j]->idom != NULL)
+          idom = idom == NULL ? b->pred[j] : intersect(b->pred[j], idom);
+      if (idom != b->idom)
+      {
+        b->idom = idom;
+        changed = TRUE;
+      }
+    }
+  } while (changed);
+  for (i = 0; i < n; i++)
+    list[i]->domChild = list[i]->domNext = NULL;
+  for (i = 0; i < n - 1; i++)
+  {
+    b = list[i];
+    b->domNext = b->idom->domChild;
+    b->idom->domChild = b;
+  }
+  free(list);
+  free(seen);
+}
+
+/* Function irDominates tells whether a
+ * dominates b
+ */
+int irDominates(IrBlock *a, IrBlock *b)
+{
+  while (b != a && b->idom != b)
+    b = b->idom;
+  return b == a;
+}
+
+/* Procedure irLoopDepth finds the natural loop
+ * of each header, the blocks that reach one of
+ * the back edges to it without passing through
+ * it, and counts it in their depth
+ */
+void irLoopDepth(IrFunc *f)
+{
+  int n = f->nblocks, i, j, nwork, loop;
+  char *body = (char *)malloc(n * sizeof(char));
+  IrBlock **work = (IrBlock **)malloc((n + 1) * sizeof(IrBlock *));
+  IrBlock *h, *b;
+  irDominators(f);
+  for (i = 0; i < n; i++)
+    f->blocks[i]->depth = 0;
+  for (i = 0; i < n; i++)
+  {
+    h = f->blocks[i];
+    memset(body, 0, n);
+    body[i] = TRUE;
+    nwork = 0;
+    loop = FALSE;
+    for (j = 0; j < h->npred; j++)
+      if (irDominates(h, h->pred[j]))
+      {
+        loop = TRUE;
+        if (!body[h->pred[j]->id])
+        {
+          body[h->pred[j]->id] = TRUE;
+          work[nwork++] = h->pred[j];
+        }
+      }
+    if (!loop)
+      continue;
+    while (nwork > 0)
+    {
+      b = work[--nwork];
+      for (j = 0; j < b->npred; j++)
+        if (!body[b->pred[j]->id])
+        {
+          body[b->pred[j]->id] = TRUE;
+          work[nwork++] = b->pred[j];
+        }
+    }
+    for (j = 0; j < n; j++)
+      if (body[j])
+        f->blocks[j]->depth++;
+  }
+  free(body);
+  free(work);
+}
+
+/***********************************************/
+/* construction of SSA form                    */
+/***********************************************/
+
+/* the vregs below nvars that belong to a
+ * variable are the ones renamed
+ */
+static int nvars;
+
+/* name[v] is the vreg holding the current value
+ * of variable v during renaming, or -1; the log
+ * records the names replaced so they can be
+ * restored when leaving a dominator subtree
+ */
+static int *name;
+static int *undef;
+static int *logVar, *logName;
+static int nlog;
+
+static int isVar(int v)
+{
+  return v >= 0 && v < nvars && fn->vregVar[v] != NULL;
+}
+
+/* Function current returns the vreg holding
+ * variable v, making a zero for it at the entry
+ * if it has not been assigned yet
+ */
+static int current(int v)
+{
+  IrBlock *entry;
+  IrInstr *in;
+  if (name[v] >= 0)
+    return name[v];
+  if (undef[v] < 0)
+  {
+    entry = fn->blocks[0];
+    undef[v] = irNewVreg(fn, fn->vregVar[v]);
+    in = irNew(IrConst, undef[v], 0);
+    irInsertBefore(entry, entry->first, in);
+  }
+  return undef[v];
+}
+
+static void setName(int v, int n)
+{
+  logVar[nlog] = v;
+  logName[nlog++] = name[v];
+  name[v] = n;
+}
+
+/* Procedure renameBlock gives the assignments in the
+ * dominator subtree of b vregs of their own and
+ * makes the reads refer to them
+ */
+static void renameBlock(IrBlock *b)
+{
+  IrInstr *in;
+  IrBlock *s, *c;
+  int i, j, mark = nlog;
+  for (in = b->first; in != NULL; in = in->next)
+  {
+    if (in->op != IrPhi)
+      for (i = 0; i < in->nargs; i++)
+        if (isVar(in->args[i]))
+          in->args[i] = current(in->args[i]);
+    if (isVar(in->dst))
+    {
+      j = irNewVreg(fn, fn->vregVar[in->dst]);
+      setName(in->dst, j);
+      in->dst = j;
+    }
+  }
+  for (i = 0; i < b->nsucc; i++)
+  {
+    s = b->succ[i];
+    for (in = s->first; in != NULL && in->op == IrPhi; in = in->next)
+      for (j = 0; j < in->nargs; j++)
+        if (in->from[j] == b && isVar(in->args[j]))
+          in->args[j] = current(in->args[j]);
+  }
+  for (c = b->domChild; c != NULL; c = c->domNext)
+    renameBlock(c);
+  while (nlog > mark)
+  {
+    nlog--;
+    name[logVar[nlog]] = logName[nlog];
+  }
+}
+
+/* Procedure insertPhi puts a phi for variable v
+ * at the start of b
+ */
+static void insertPhi(IrBlock *b, int v)
+{
+  IrInstr *in = irNew(IrPhi, v, b->npred);
+  int i;
+  in->from = (IrBlock **)malloc(b->npred * sizeof(IrBlock *));
+  for (i = 0; i < b->npred; i++)
+  {
+    in->args[i] = v;
+    in->from[i] = b->pred[i];
+  }
+  irInsertBefore(b, b->first, in);
+}
+
+/* Procedure irToSSA places phis at the iterated
+ * dominance frontiers of the assignments of each
+ * variable live across blocks (semi-pruned SSA)
+ * and renames the variables
+ */
+void irToSSA(IrFunc *f)
+{
+  int n, v, i, j, k, nwork, count;
+  char *frontier, *defs, *global, *seen, *hasPhi, *inWork;
+  IrBlock *b, *r, **work;
+  IrInstr *in;
+  fn = f;
+  irCFG(f);
+  irDominators(f);
+  n = f->nblocks;
+  nvars = f->nvregs;
+
+  /* frontier[d * n + b] is set if b is in the
+   * dominance frontier of d
+   */
+  frontier = (char *)calloc(n * n, sizeof(char));
+  for (i = 0; i < n; i++)
+  {
+    b = f->blocks[i];
+    if (b->npred < 2)
+      continue;
+    for (j = 0; j < b->npred; j++)
+      for (r = b->pred[j]; r != b->idom; r = r->idom)
+        frontier[r->id * n + i] = TRUE;
+  }
+
+  /* defs[v * n + b] is set if b assigns v;
+   * global[v] if v is read in a block before
+   * being assigned there
+   */
+  defs = (char *)calloc(nvars * n, sizeof(char));
+  global = (char *)calloc(nvars, sizeof(char));
+  seen = (char *)calloc(nvars, sizeof(char));
+  for (i = 0; i < n; i++)
+  {
+    for (in = f->blocks[i]->first; in != NULL; in = in->next)
+    {
+      for (j = 0; j < in->nargs; j++)
+        if (isVar(in->args[j]) && !seen[in->args[j]])
+          global[in->args[j]] = TRUE;
+      if (isVar(in->dst))
+      {
+        seen[in->dst] = TRUE;
+        defs[in->dst * n + i] = TRUE;
+      }
+    }
+    for (in = f->blocks[i]->first; in != NULL; in = in->next)
+      if (isVar(in->dst))
+        seen[in->dst] = FALSE;
+  }
+
+  hasPhi = (char *)malloc(n * sizeof(char));
+  inWork = (char *)malloc(n * sizeof(char));
+  work = (IrBlock **)malloc(n * sizeof(IrBlock *));
+  for (v = 0; v < nvars; v++)
+  {
+    if (!global[v])
+      continue;
+    nwork = 0;
+    for (i = 0; i < n; i++)
+    {
+      hasPhi[i] = FALSE;
+      inWork[i] = defs[v * n + i];
+      if (inWork[i])
+        work[nwork++] = f->blocks[i];
+    }
+    while (nwork > 0)
+    {
+      k = work[--nwork]->id;
+      for (i = 0; i < n; i++)
+        if (frontier[k * n + i] && !hasPhi[i])
+        {
+          insertPhi(f->blocks[i], v);
+          hasPhi[i] = TRUE;
+          if (!inWork[i])
+          {
+            inWork[i] = TRUE;
+            work[nwork++] = f->blocks[i];
+          }
+        }
+    }
+  }
+  free(frontier);
+  free(defs);
+  free(global);
+  free(seen);
+  free(hasPhi);
+  free(inWork);
+  free(work);
+
+  count = 0;
+  for (i = 0; i < n; i++)
+    for (in = f->blocks[i]->first; in != NULL; in = in->next)
+      count++;
+  name = (int *)malloc(nvars * sizeof(int));
+  undef = (int *)malloc(nvars * sizeof(int));
+  for (v = 0; v < nvars; v++)
+    name[v] = undef[v] = -1;
+  logVar = (int *)malloc((count + 1) * sizeof(int));
+  logName = (int *)malloc((count + 1) * sizeof(int));
+  nlog = 0;
+  renameBlock(f->blocks[0]);
+  free(name);
+  free(undef);
+  free(logVar);
+  free(logName);
+}
+
+/***********************************************/
+/* leaving SSA form                            */
+/***********************************************/
+
+typedef unsigned long Word;
+#define WORDBITS (8 * sizeof(Word))
+
+static int setWords;
+
+static int inSet(Word *s, int v)
+{
+  return (s[v / WORDBITS] >> (v % WORDBITS)) & 1;
+}
+
+static void addSet(Word *s, int v)
+{
+  s[v / WORDBITS] |= (Word)1 << (v % WORDBITS);
+}
+
+/* liveOut[b] holds the vregs live on exit from
+ * block b, a phi reading its operands at the end
+ * of the predecessor they come from; defOf[v] is
+ * the instruction assigning v and defPos[v] its
+ * index in the block, 0 for all phis
+ */
+static Word **liveOut;
+static IrInstr **defOf;
+static int *defPos;
+
+/* Procedure ssaLiveness computes liveOut, defOf
+ * and defPos
+ */
+static void ssaLiveness(void)
+{
+  int n = fn->nblocks, i, j, w, pos, changed;
+  Word **use, **def, **liveIn, x;
+  IrBlock *b;
+  IrInstr *in;
+  setWords = fn->nvregs / WORDBITS + 1;
+  use = (Word **)malloc(n * sizeof(Word *));
+  def = (Word **)malloc(n * sizeof(Word *));
+  liveIn = (Word **)malloc(n * sizeof(Word *));
+  liveOut = (Word **)malloc(n * sizeof(Word *));
+  defOf = (IrInstr **)calloc(fn->nvregs, sizeof(IrInstr *));
+  defPos = (int *)calloc(fn->nvregs, sizeof(int));
+  for (i = 0; i < n; i++)
+  {
+    use[i] = (Word *)calloc(setWords, sizeof(Word));
+    def[i] = (Word *)calloc(setWords, sizeof(Word));
+    liveIn[i] = (Word *)calloc(setWords, sizeof(Word));
+    liveOut[i] = (Word *)calloc(setWords, sizeof(Word));
+  }
+  for (i = 0; i < n; i++)
+  {
+    b = fn->blocks[i];
+    pos = 0;
+    for (in = b->first; in != NULL; in = in->next)
+    {
+      if (in->op == IrPhi)
+        for (j = 0; j < in->nargs; j++)
+          addSet(use[in->from[j]->id], in->args[j]);
+      else
+      {
+        pos++;
+        for (j = 0; j < in->nargs; j++)
+          if (!inSet(def[i], in->args[j]))
+            addSet(use[i], in->args[j]);
+      }
+      if (in->dst >= 0)
+      {
+        addSet(def[i], in->dst);
+        defOf[in->dst] = in;
+        defPos[in->dst] = in->op == IrPhi ? 0 : pos;
+      }
+    }
+  }
+  /* the phi operands read by a block are live on
+   * its exit, not its entry
+   */
+  for (i = 0; i < n; i++)
+    for (in = fn->blocks[i]->first; in != NULL && in->op == IrPhi; in = in->next)
+      for (j = 0; j < in->nargs; j++)
+        addSet(liveOut[in->from[j]->id], in->args[j]);
+  do
+  {
+    changed = FALSE;
+    for (i = n - 1; i >= 0; i--)
+    {
+      b = fn->blocks[i];
+      for (w = 0; w < setWords; w++)
+      {
+        x = liveOut[i][w];
+        for (j = 0; j < b->nsucc; j++)
+          x |= liveIn[b->succ[j]->id][w];
+        liveOut[i][w] = x;
+        x = (use[i][w] & ~def[i][w]) | (x & ~def[i][w]);
+        if (x != liveIn[i][w])
+        {
+          liveIn[i][w] = x;
+          changed = TRUE;
+        }
+      }
+    }
+  } while (changed);
+  for (i = 0; i < n; i++)
+  {
+    free(use[i]);
+    free(def[i]);
+    free(liveIn[i]);
+  }
+  free(use);
+  free(def);
+  free(liveIn);
+}
+
+/* Function liveAfter tells whether x is live
+ * just after the assignment of y
+ */
+static int liveAfter(int x, int y)
+{
+  IrInstr *d = defOf[y], *in;
+  int j;
+  if (defOf[x] == NULL || d == NULL)
+    return TRUE;
+  if (defOf[x]->block == d->block && defPos[x] > defPos[y])
+    return FALSE;
+  if (inSet(liveOut[d->block->id], x))
+    return TRUE;
+  for (in = d->next; in != NULL; in = in->next)
+    if (in->op != IrPhi)
+      for (j = 0; j < in->nargs; j++)
+        if (in->args[j] == x)
+          return TRUE;
+  return FALSE;
+}
+
+/* the names merged so far: leader[v] leads the
+ * class of v, whose members are linked through
+ * member from the leader
+ */
+static int *leader, *member;
+
+static int findLeader(int v)
+{
+  while (leader[v] != v)
+    v = leader[v] = leader[leader[v]];
+  return v;
+}
+
+/* Procedure merge gives a and b one name if no
+ * value of the class of a is live where one of
+ * the class of b is assigned, or the reverse
+ */
+static void merge(int a, int b)
+{
+  int x, y;
+  a = findLeader(a);
+  b = findLeader(b);
+  if (a == b)
+    return;
+  for (x = a; x >= 0; x = member[x])
+    for (y = b; y >= 0; y = member[y])
+      if (liveAfter(x, y) || liveAfter(y, x))
+        return;
+  for (x = a; member[x] >= 0; x = member[x])
+    ;
+  member[x] = b;
+  leader[b] = a;
+}
+
+/* Function isRemat tells whether v is a constant
+ * or array address, which the code generator
+ * loads again where it is read; giving it the
+ * name of a variable would only keep it live
+ */
+static int isRemat(int v)
+{
+  return defOf[v] != NULL && (defOf[v]->op == IrConst || defOf[v]->op == IrAddr);
+}
+
+/* Procedure mergeNames gives the operands of each
+ * phi and copy the name of its result wherever
+ * their values do not interfere, so that no copy
+ * is needed for them
+ */
+static void mergeNames(void)
+{
+  IrInstr *in;
+  int i, j, v;
+  ssaLiveness();
+  leader = (int *)malloc(fn->nvregs * sizeof(int));
+  member = (int *)malloc(fn->nvregs * sizeof(int));
+  for (v = 0; v < fn->nvregs; v++)
+  {
+    leader[v] = v;
+    member[v] = -1;
+  }
+  for (i = 0; i < fn->nblocks; i++)
+    for (in = fn->blocks[i]->first; in != NULL; in = in->next)
+      if (in->op == IrPhi || in->op == IrCopy)
+        for (j = 0; j < in->nargs; j++)
+          if (!isRemat(in->args[j]))
+            merge(in->dst, in->args[j]);
+  for (i = 0; i < fn->nblocks; i++)
+    for (in = fn->blocks[i]->first; in != NULL; in = in->next)
+    {
+      if (in->dst >= 0)
+        in->dst = findLeader(in->dst);
+      for (j = 0; j < in->nargs; j++)
+        in->args[j] = findLeader(in->args[j]);
+    }
+  for (i = 0; i < fn->nblocks; i++)
+    free(liveOut[i]);
+  free(liveOut);
+  free(defOf);
+  free(defPos);
+  free(leader);
+  free(member);
+}
+
+static void insertCopy(IrBlock *b, IrInstr *pos, int dst, int src)
+{
+  IrInstr *in = irNew(IrCopy, dst, 1);
+  in->args[0] = src;
+  irInsertBefore(b, pos, in);
+}
+
+/* Procedure parallelCopy assigns src[i] to
+ * dst[i] for all i at once before the last
+ * instruction of b, ordering the copies so none
+ * overwrites a source still to be read and
+ * breaking cycles with a temporary
+ */
+static void parallelCopy(IrBlock *b, int *dst, int *src, int n)
+{
+  int i, j, t;
+  for (i = 0; i < n;)
+    if (dst[i] == src[i])
+    {
+      n--;
+      dst[i] = dst[n];
+      src[i] = src[n];
+    }
+    else
+      i++;
+  while (n > 0)
+  {
+    for (i = 0; i < n; i++)
+    {
+      for (j = 0; j < n && (j == i || src[j] != dst[i]); j++)
+        ;
+      if (j == n)
+        break;
+    }
+    if (i < n)
+    {
+      insertCopy(b, b->last, dst[i], src[i]);
+      n--;
+      dst[i] = dst[n];
+      src[i] = src[n];
+    }
+    else
+    {
+      t = irNewVreg(fn, NULL);
+      insertCopy(b, b->last, t, dst[0]);
+      for (j = 0; j < n; j++)
+        if (src[j] == dst[0])
+          src[j] = t;
+    }
+  }
+}
+
+/* Function needsCopy tells whether a phi of b
+ * must copy a value on the edge from p
+ */
+static int needsCopy(IrBlock *p, IrBlock *b)
+{
+  IrInstr *in;
+  int k;
+  for (in = b->first; in != NULL && in->op == IrPhi; in = in->next)
+    for (k = 0; k < in->nargs; k++)
+      if (in->from[k] == p && in->args[k] != in->dst)
+        return TRUE;
+  return FALSE;
+}
+
+/* Procedure splitEdges puts a block of its own
+ * on every edge from a block with several
+ * successors to a block with phis and several
+ * predecessors that needs copies, where the
+ * copies can go
+ */
+static void splitEdges(void)
+{
+  IrBlock *b, *p, *e;
+  IrInstr *in;
+  int i, j, k, n = fn->nblocks;
+  for (i = 0; i < n; i++)
+  {
+    b = fn->blocks[i];
+    if (b->first == NULL || b->first->op != IrPhi || b->npred < 2)
+      continue;
+    for (j = 0; j < b->npred; j++)
+    {
+      p = b->pred[j];
+      if (p->nsucc < 2 || !needsCopy(p, b))
+        continue;
+      e = irNewBlock(fn);
+      in = irNew(IrJump, -1, 0);
+      in->target[0] = b;
+      irAppend(e, in);
+      for (k = 0; k < 2; k++)
+        if (p->last->target[k] == b)
+          p->last->target[k] = e;
+      for (in = b->first; in != NULL && in->op == IrPhi; in = in->next)
+        for (k = 0; k < in->nargs; k++)
+          if (in->from[k] == p)
+            in->from[k] = e;
+    }
+  }
+  irCFG(fn);
+}
+
+/* Procedure coalesce removes the copies dst = s
+ * where s is assigned once, just before in the
+ * same block, and read only by the copy: the
+ * assignment of s assigns dst instead
+ */
+static void coalesce(void)
+{
+  int *ndefs = (int *)calloc(fn->nvregs, sizeof(int));
+  int *nuses = (int *)calloc(fn->nvregs, sizeof(int));
+  IrInstr **def = (IrInstr **)calloc(fn->nvregs, sizeof(IrInstr *));
+  IrInstr *in, *next, *d, *x;
+  int i, j, s, clash;
+  for (i = 0; i < fn->nblocks; i++)
+    for (in = fn->blocks[i]->first; in != NULL; in = in->next)
+    {
+      for (j = 0; j < in->nargs; j++)
+        nuses[in->args[j]]++;
+      if (in->dst >= 0)
+      {
+        ndefs[in->dst]++;
+        def[in->dst] = in;
+      }
+    }
+  for (i = 0; i < fn->nblocks; i++)
+    for (in = fn->blocks[i]->first; in != NULL; in = next)
+    {
+      next = in->next;
+      if (in->op != IrCopy)
+        continue;
+      s = in->args[0];
+      d = def[s];
+      if (s == in->dst || ndefs[s] != 1 || nuses[s] != 1 || d->block != in->block)
+        continue;
+      clash = FALSE;
+      for (x = d->next; x != in && x != NULL && !clash; x = x->next)
+      {
+        clash = x->dst == in->dst;
+        for (j = 0; j < x->nargs; j++)
+          clash = clash || x->args[j] == in->dst;
+      }
+      if (x != in || clash)
+        continue;
+      d->dst = in->dst;
+      def[in->dst] = d;
+      ndefs[s] = nuses[s] = 0;
+      irDelete(in);
+    }
+  free(ndefs);
+  free(nuses);
+  free(def);
+}
+
+/* Procedure irFromSSA turns each phi into copies
+ * on the edges into its block
+ */
+void irFromSSA(IrFunc *f)
+{
+  IrBlock *b, *p;
+  IrInstr *in;
+  int *dst, *src;
+  int i, j, k, n;
+  fn = f;
+  irCFG(f);
+  mergeNames();
+  splitEdges();
+  for (i = 0; i < f->nblocks; i++)
+  {
+    b = f->blocks[i];
+    if (b->first == NULL || b->first->op != IrPhi)
+      continue;
+    for (n = 0, in = b->first; in != NULL && in->op == IrPhi; in = in->next)
+      n++;
+    dst = (int *)malloc(n * sizeof(int));
+    src = (int *)malloc(n * sizeof(int));
+    for (j = 0; j < b->npred; j++)
+    {
+      p = b->pred[j];
+      if (p->last->op == IrBranch && p->nsucc == 1)
+      {
+        /* both ways go to b */
+        p->last->op = IrJump;
+        p->last->nargs = 0;
+      }
+      for (n = 0, in = b->first; in != NULL && in->op == IrPhi; in = in->next)
+        for (k = 0; k < in->nargs; k++)
+          if (in->from[k] == p)
+          {
+            dst[n] = in->dst;
+            src[n++] = in->args[k];
+          }
+      parallelCopy(p, dst, src, n);
+    }
+    free(dst);
+    free(src);
+    while (b->first != NULL && b->first->op == IrPhi)
+      irDelete(b->first);
+  }
+  coalesce();
+  irCFG(f);
+}
@@ -0,0 +1,43 @@
+/****************************************************/
+/* File: ssa.h                                      */
+/* Dominators and SSA form of the IR of the         */
+/* C-Minus compiler                                 */
+/****************************************************/
+
+#ifndef _SSA_H_
+#define _SSA_H_
+
+#include "ir.h"
+
+/* Procedure irDominators sets the immediate
+ * dominator, dominator tree links and reverse
+ * postorder number of every block of f; the
+ * entry is its own immediate dominator
+ */
+void irDominators(IrFunc *f);
+
+/* Function irDominates tells whether block a
+ * dominates block b, after irDominators
+ */
+int irDominates(IrBlock *a, IrBlock *b);
+
+/* Procedure irLoopDepth sets the number of
+ * natural loops of f each block belongs to
+ */
+void irLoopDepth(IrFunc *f);
+
+/* Procedure irToSSA puts f in SSA form: every
+ * variable assignment gets a vreg of its own and
+ * phis merge them where control flow joins. A
+ * variable read before any assignment reads 0
+ */
+void irToSSA(IrFunc *f);
+
+/* Procedure irFromSSA replaces the phis of f by
+ * copies at the end of their predecessors,
+ * splitting the edges that need it, and folds
+ * the copies of values computed just before
+ */
+void irFromSSA(IrFunc *f);
+
+#endif
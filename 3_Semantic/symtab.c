@@ -3,7 +3,9 @@
 /* Symbol table implementation for the TINY compiler*/
 /* (allows only one symbol table)                   */
 /* Symbol table is implemented as a chained         */
-/* hash table                                       */
+/* hash table per scope; with ShadowScopes, a       */
+/* global table of interned names additionally      */
+/* holds a stack of bindings for each name          */
 /* Compiler Construction: Principles and Practice   */
 /* Kenneth C. Louden                                */
 /****************************************************/
@@ -20,9 +22,23 @@
 
 /* the hash table */
 // static BucketList hashTable[SIZE];
-static ScopeList scopes[SIZE];
+static ScopeList *scopes = NULL;
 static int sidx = 0;
-ScopeList currScope = NULL;
+static int scopeCap = 0;
+_Thread_local ScopeList currScope = NULL;
+
+/* the table of interned names and the innermost
+ * scope whose bindings are pushed on them
+ */
+static NameList names[SIZE];
+static ScopeList shadowTop = NULL;
+
+/* counters reported by printSymTabStats */
+#define MAXCHAIN 8
+static _Thread_local LookupStats lstats; /* st_lookup counters */
+static long lineRefs = 0;    /* line list records */
+static int maxLines = 0;
+static long bytesUsed = 0;   /* bytes allocated by the symbol table */
 
 /* the hash function */
 static int hash(char *key)
@@ -37,9 +53,39 @@ static int hash(char *key)
   return temp;
 }
 
+/* Function findName returns the interned
+ * record for name, or NULL if there is none
+ */
+static NameList findName(char *name)
+{
+  NameList n = names[hash(name)];
+  while ((n != NULL) && (strcmp(name, n->name) != 0))
+    n = n->next;
+  return n;
+}
+
+/* Function intern returns the unique record
+ * for name, creating it on first use
+ */
+static NameList intern(char *name)
+{
+  NameList n = findName(name);
+  if (n == NULL)
+  {
+    int h = hash(name);
+    n = (NameList)malloc(sizeof(struct NameRec));
+    bytesUsed += sizeof(struct NameRec);
+    n->name = name;
+    n->top = NULL;
+    n->next = names[h];
+    names[h] = n;
+  }
+  return n;
+}
+
 ScopeList findScope(char *scope)
 {
-  for (int i = 0; i < SIZE; i++)
+  for (int i = 0; i < sidx; i++)
     if (strcmp(scope, scopes[i]->name) == 0)
       return scopes[i];
   return NULL;
@@ -47,23 +93,80 @@ ScopeList findScope(char *scope)
 
 ScopeList addScope(char *name)
 {
-  ScopeList newScope = (ScopeList)malloc(sizeof(struct ScopeListRec));
+  ScopeList newScope = (ScopeList)calloc(1, sizeof(struct ScopeListRec));
   newScope->name = copyString(name);
+  bytesUsed += sizeof(struct ScopeListRec) + strlen(name) + 1;
   newScope->parent = currScope;
+  /* blocks inside a function continue the
+   * frame of the enclosing scope; functions
+   * and the globals start at 0
+   */
+  if (currScope != NULL && currScope != preludeScope() &&
+      currScope->parent != preludeScope())
+    newScope->location = currScope->location;
   currScope = newScope;
+  lstats.scopes++;
+  if (sidx == scopeCap)
+  {
+    scopeCap = scopeCap ? 2 * scopeCap : SIZE;
+    bytesUsed += (scopeCap - sidx) * sizeof(ScopeList);
+    scopes = (ScopeList *)realloc(scopes, scopeCap * sizeof(ScopeList));
+  }
   scopes[sidx++] = newScope;
+  if (ShadowScopes)
+    shadowTop = newScope;
   return newScope;
 }
 
-/* Procedure st_insert inserts line numbers and
+/* Procedure enterScope makes scope, opened
+ * before by addScope, current again
+ */
+void enterScope(ScopeList scope)
+{
+  lstats.scopes++;
+  currScope = scope;
+}
+
+/* Procedure leaveScope closes currScope and
+ * makes its parent current again
+ */
+void leaveScope(void)
+{
+  if (ShadowScopes && shadowTop == currScope)
+  {
+    BucketList l;
+    for (l = currScope->symbols; l != NULL; l = l->scopeNext)
+      if (l->intern != NULL)
+        l->intern->top = l->shadow;
+    shadowTop = currScope->parent;
+  }
+  currScope = currScope->parent;
+}
+
+/* Function st_slots returns the number of memory
+ * locations taken by the variable declared by t:
+ * the size of an array, 1 for anything else
+ */
+int st_slots(TreeNode *t)
+{
+  if (t != NULL && t->nodekind == StmtK && t->kind.stmt == VarDeclK && t->child[0] != NULL)
+    return t->child[0]->attr.val;
+  return 1;
+}
+
+/* Function st_insert inserts line numbers and
  * memory locations into the symbol table
  * loc = memory location is inserted only the
- * first time, otherwise ignored
+ * first time, otherwise ignored.
+ * Returns the record for name in scope
  */
-void st_insert(ScopeList scope, char *name, ExpType type, int lineno, TreeNode *t)
+BucketList st_insert(ScopeList scope, char *name, ExpType type, int lineno, TreeNode *t)
 {
   // ScopeList insertScope = findScope(scope);
-  int h = hash(name);
+  int h;
+  if (scope == preludeScope()) /* built-ins are immutable */
+    return prelude_lookup(name);
+  h = hash(name);
   BucketList l = scope->bucket[h];
   while ((l != NULL) && (strcmp(name, l->name) != 0))
     l = l->next;
@@ -75,47 +178,125 @@ void st_insert(ScopeList scope, char *name, ExpType type, int lineno, TreeNode *
     l->lines = (LineList)malloc(sizeof(struct LineListRec));
     l->lines->lineno = lineno;
     l->lines->next = NULL;
-    l->memloc = scope->location++;
+    l->lastLine = l->lines;
+    l->lineCount = 0;
+    l->memloc = scope->location;
+    scope->location += st_slots(t);
     l->next = scope->bucket[h];
     l->scope = scope;
     l->treeNode = t;
+    l->arity = -1;
+    l->paramTypes = NULL;
+    l->scopeNext = NULL;
+    l->shadow = NULL;
+    l->intern = NULL;
     scope->bucket[h] = l;
+    if (scope->lastSymbol == NULL)
+      scope->symbols = l;
+    else
+      scope->lastSymbol->scopeNext = l;
+    scope->lastSymbol = l;
+    if (ShadowScopes && scope == shadowTop)
+    { /* push the new binding over the outer ones */
+      l->intern = intern(name);
+      l->shadow = l->intern->top;
+      l->intern->top = l;
+    }
+    bytesUsed += sizeof(struct BucketListRec) + sizeof(struct LineListRec);
+    lineRefs++;
   }
   else /* found in table, so just add line number */
   {
-    LineList t = l->lines;
-    while (t->next != NULL)
-      t = t->next;
+    LineList t = l->lastLine;
     t->next = (LineList)malloc(sizeof(struct LineListRec));
     t->next->lineno = lineno;
     t->next->next = NULL;
+    l->lastLine = t->next;
+    bytesUsed += sizeof(struct LineListRec);
+    lineRefs++;
   }
+  if (++l->lineCount > maxLines)
+    maxLines = l->lineCount;
+  return l;
 } /* st_insert */
 
-/* Function st_lookup returns the memory
- * location of a variable or -1 if not found
+/* Procedure st_setSignature records the arity and
+ * parameter types of function l from its
+ * parameter list params
+ */
+void st_setSignature(BucketList l, TreeNode *params)
+{
+  TreeNode *p;
+  int n = 0;
+  if (params != NULL && params->nodekind == ExpK && params->kind.exp == VoidParamK)
+    params = NULL;
+  for (p = params; p != NULL; p = p->sibling)
+    n++;
+  l->arity = n;
+  l->paramTypes = (unsigned char *)malloc(n > 0 ? n : 1);
+  bytesUsed += n > 0 ? n : 1;
+  for (n = 0, p = params; p != NULL; p = p->sibling)
+    l->paramTypes[n++] = (unsigned char)p->type;
+}
+
+/* Function st_lookup returns the record of the
+ * innermost visible declaration of name,
+ * or NULL if not found
  */
 BucketList st_lookup(ScopeList scope, char *name)
 {
   ScopeList lookupScope = scope;
-  int h = hash(name);
+  BucketList l = NULL;
+  int h, depth = 0;
+  lstats.lookups++;
+  if (ShadowScopes && scope == shadowTop)
+  {
+    NameList n = findName(name);
+    lstats.probes++;
+    l = n != NULL ? n->top : NULL;
+    return l != NULL ? l : prelude_lookup(name);
+  }
+  h = hash(name);
   while (lookupScope != NULL)
   {
-    BucketList l = lookupScope->bucket[h];
+    if (lookupScope == preludeScope())
+    {
+      l = prelude_lookup(name);
+      lstats.probes++;
+      break;
+    }
+    l = lookupScope->bucket[h];
     while ((l != NULL) && (strcmp(name, l->name) != 0))
+    {
+      lstats.probes++;
       l = l->next;
+    }
     if (l != NULL)
     {
-      return l;
+      lstats.probes++;
+      break;
     }
     lookupScope = lookupScope->parent;
+    if (lookupScope != NULL)
+      depth++;
   }
-  return NULL;
+  lstats.hops += depth;
+  if (depth > lstats.maxHops)
+    lstats.maxHops = depth;
+  return l;
 }
 BucketList st_lookup_excluding_parent(ScopeList scope, char *name)
 {
   if (scope == NULL)
     return NULL;
+  if (scope == preludeScope())
+    return prelude_lookup(name);
+  if (ShadowScopes && scope == shadowTop)
+  {
+    NameList n = findName(name);
+    BucketList top = n != NULL ? n->top : NULL;
+    return (top != NULL && top->scope == scope) ? top : NULL;
+  }
   int h = hash(name);
   BucketList l = scope->bucket[h];
   while ((l != NULL) && (strcmp(name, l->name) != 0))
@@ -142,42 +323,266 @@ static const char *typeToString(ExpType type)
   }
 }
 
+/* the symbol table dumps are formatted into
+ * outBuf and written out in large blocks
+ */
+#define OUTBUFLEN 65536
+static char outBuf[OUTBUFLEN];
+static int outLen = 0;
+static FILE *outFile = NULL;
+
+static void outFlush(void)
+{
+  fwrite(outBuf, 1, outLen, outFile);
+  outLen = 0;
+}
+
+static void outChars(const char *s, int n)
+{
+  while (n > 0)
+  {
+    int k = OUTBUFLEN - outLen;
+    if (k == 0)
+    {
+      outFlush();
+      k = OUTBUFLEN;
+    }
+    if (k > n)
+      k = n;
+    memcpy(outBuf + outLen, s, k);
+    outLen += k;
+    s += k;
+    n -= k;
+  }
+}
+
+static void outStr(const char *s)
+{
+  outChars(s, strlen(s));
+}
+
+static void outSpaces(int n)
+{
+  static const char spaces[] = "                ";
+  while (n > 0)
+  {
+    int k = n < 16 ? n : 16;
+    outChars(spaces, k);
+    n -= k;
+  }
+}
+
+/* outStrPad writes s left-justified in a
+ * field of width characters (like "%-*s")
+ */
+static void outStrPad(const char *s, int width)
+{
+  int n = strlen(s);
+  outChars(s, n);
+  outSpaces(width - n);
+}
+
+/* outInt writes v in a field of |width|
+ * characters, right-justified for a positive
+ * width and left-justified for a negative one
+ */
+static void outInt(int v, int width)
+{
+  char digits[12];
+  int n = 0;
+  unsigned int u = v < 0 ? -(unsigned int)v : (unsigned int)v;
+  do
+  {
+    digits[sizeof(digits) - 1 - n++] = '0' + u % 10;
+    u /= 10;
+  } while (u != 0);
+  if (v < 0)
+    digits[sizeof(digits) - 1 - n++] = '-';
+  if (width > n)
+    outSpaces(width - n);
+  outChars(digits + sizeof(digits) - n, n);
+  if (-width > n)
+    outSpaces(-width - n);
+}
+
+static void outJSONStr(const char *s)
+{
+  outChars("\"", 1);
+  for (; *s != '\0'; s++)
+  {
+    if (*s == '"' || *s == '\\')
+      outChars("\\", 1);
+    outChars(s, 1);
+  }
+  outChars("\"", 1);
+}
+
 /* Procedure printSymTab prints a formatted
  * listing of the symbol table contents
- * to the listing file
+ * to the listing file. Scopes appear in the
+ * order they were opened and symbols in
+ * declaration (location) order, so the
+ * listing does not depend on the hash function
  */
 void printSymTab(FILE *listing)
 {
-  int i, j;
-  fprintf(listing, "Variable Name  Type        Location  Scope      Line Numbers\n");
-  fprintf(listing, "-------------  ----        --------  -----      ------------\n");
-  for (j = 0; j < SIZE; ++j)
+  int j;
+  outFile = listing;
+  outStr("Variable Name  Type        Location  Scope      Line Numbers\n");
+  outStr("-------------  ----        --------  -----      ------------\n");
+  for (j = 0; j < sidx; ++j)
   {
-    if (scopes[j] != NULL)
+    ScopeList scope = scopes[j];
+    BucketList l;
+    for (l = scope->symbols; l != NULL; l = l->scopeNext)
     {
-      ScopeList scope = scopes[j];
-      for (i = 0; i < SIZE; ++i)
+      LineList t;
+      outStrPad(l->name, 14);
+      outChars(" ", 1);
+      outStrPad(typeToString(l->type), 11);
+      outChars(" ", 1);
+      outInt(l->memloc, -8);
+      outChars("  ", 2);
+      outStrPad(scope->name, 2);
+      outChars("  ", 2);
+      for (t = l->lines; t != NULL; t = t->next)
       {
-        if (scope->bucket[i] != NULL)
-        {
-          BucketList l = scope->bucket[i];
-          while (l != NULL)
-          {
-            LineList t = l->lines;
-            fprintf(listing, "%-14s ", l->name);
-            fprintf(listing, "%-11s ", typeToString(l->type));
-            fprintf(listing, "%-8d  ", l->memloc);
-            fprintf(listing, "%-2s  ", scope->name);
-            while (t != NULL)
-            {
-              fprintf(listing, "%4d ", t->lineno);
-              t = t->next;
-            }
-            fprintf(listing, "\n");
-            l = l->next;
-          }
-        }
+        outInt(t->lineno, 4);
+        outChars(" ", 1);
       }
+      outChars("\n", 1);
     }
   }
+  outFlush();
 } /* printSymTab */
+
+/* Procedure printSymTabJSON writes the symbol
+ * table contents as a JSON document for
+ * external tools, in the same order as
+ * printSymTab
+ */
+void printSymTabJSON(FILE *listing)
+{
+  int j;
+  outFile = listing;
+  outStr("{\"scopes\":[");
+  for (j = 0; j < sidx; ++j)
+  {
+    ScopeList scope = scopes[j];
+    BucketList l;
+    if (j > 0)
+      outChars(",", 1);
+    outStr("\n{\"name\":");
+    outJSONStr(scope->name);
+    outStr(",\"parent\":");
+    if (scope->parent != NULL)
+      outJSONStr(scope->parent->name);
+    else
+      outStr("null");
+    outStr(",\"symbols\":[");
+    for (l = scope->symbols; l != NULL; l = l->scopeNext)
+    {
+      LineList t;
+      if (l != scope->symbols)
+        outChars(",", 1);
+      outStr("\n {\"name\":");
+      outJSONStr(l->name);
+      outStr(",\"type\":");
+      outJSONStr(typeToString(l->type));
+      outStr(",\"location\":");
+      outInt(l->memloc, 0);
+      outStr(",\"lines\":[");
+      for (t = l->lines; t != NULL; t = t->next)
+      {
+        if (t != l->lines)
+          outChars(",", 1);
+        outInt(t->lineno, 0);
+      }
+      outStr("]}");
+    }
+    outStr("]}");
+  }
+  outStr("\n]}\n");
+  outFlush();
+} /* printSymTabJSON */
+
+/* Procedure st_takeLookupStats moves the st_lookup
+ * counters of the calling thread into stats
+ */
+void st_takeLookupStats(LookupStats *stats)
+{
+  *stats = lstats;
+  memset(&lstats, 0, sizeof(lstats));
+}
+
+/* Procedure st_addLookupStats adds counters taken
+ * from another thread to those of the calling one
+ */
+void st_addLookupStats(LookupStats *stats)
+{
+  lstats.lookups += stats->lookups;
+  lstats.probes += stats->probes;
+  lstats.hops += stats->hops;
+  if (stats->maxHops > lstats.maxHops)
+    lstats.maxHops = stats->maxHops;
+  lstats.scopes += stats->scopes;
+}
+
+/* Procedure st_getLookupStats copies the st_lookup
+ * counters of the calling thread into stats
+ */
+void st_getLookupStats(LookupStats *stats)
+{
+  *stats = lstats;
+}
+
+/* Procedure printSymTabStats prints counters
+ * describing the shape and cost of the symbol
+ * table to the listing file
+ */
+void printSymTabStats(FILE *listing)
+{
+  long chains[MAXCHAIN + 1] = {0};
+  long symbols = 0;
+  int maxSymbols = 0;
+  ScopeList maxScope = NULL;
+  int i, j;
+  for (j = 0; j < sidx; ++j)
+  {
+    ScopeList scope = scopes[j];
+    int count = 0;
+    for (i = 0; i < SIZE; ++i)
+    {
+      int len = 0;
+      BucketList l;
+      for (l = scope->bucket[i]; l != NULL; l = l->next)
+        len++;
+      chains[len < MAXCHAIN ? len : MAXCHAIN]++;
+      count += len;
+    }
+    symbols += count;
+    if (maxScope == NULL || count > maxSymbols)
+    {
+      maxSymbols = count;
+      maxScope = scope;
+    }
+  }
+  fprintf(listing, "\nSymbol table statistics:\n");
+  fprintf(listing, "  engine                     %s\n", ShadowScopes ? "shadow" : "chain");
+  fprintf(listing, "  scopes                     %d\n", sidx);
+  fprintf(listing, "  symbols                    %ld\n", symbols);
+  if (sidx > 0)
+    fprintf(listing, "  symbols per scope          %.2f avg, %d max (%s)\n",
+            (double)symbols / sidx, maxSymbols, maxScope->name);
+  fprintf(listing, "  line references            %ld (%d max per symbol)\n", lineRefs, maxLines);
+  fprintf(listing, "  st_lookup calls            %ld\n", lstats.lookups);
+  if (lstats.lookups > 0)
+  {
+    fprintf(listing, "  probes per st_lookup       %.2f\n", (double)lstats.probes / lstats.lookups);
+    fprintf(listing, "  parent hops per st_lookup  %.2f (%d max)\n", (double)lstats.hops / lstats.lookups, lstats.maxHops);
+  }
+  fprintf(listing, "  bytes allocated            %ld\n", bytesUsed);
+  fprintf(listing, "  bucket chain lengths       (%d buckets per scope)\n", SIZE);
+  for (i = 0; i <= MAXCHAIN; ++i)
+    fprintf(listing, "    %s%d  %ld\n", i == MAXCHAIN ? ">=" : "  ", i, chains[i]);
+} /* printSymTabStats */
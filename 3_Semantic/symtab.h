@@ -34,10 +34,17 @@ typedef struct BucketListRec
     char *name;
     ExpType type;
     LineList lines;
+    LineList lastLine;
+    int lineCount;
     int memloc; /* memory location for variable */
     struct BucketListRec *next;
     struct ScopeListRec *scope;
     TreeNode *treeNode;
+    int arity;                 /* parameters of a function, -1 otherwise */
+    unsigned char *paramTypes; /* their ExpTypes, one byte each */
+    struct BucketListRec *scopeNext; /* next symbol of the same scope */
+    struct BucketListRec *shadow;    /* outer binding of the same name */
+    struct NameRec *intern;          /* interned name (ShadowScopes) */
 } *BucketList;
 
 /* The record for each scope,
@@ -50,17 +57,102 @@ typedef struct ScopeListRec
     BucketList bucket[SIZE];
     struct ScopeListRec *parent;
     int location;
+    BucketList symbols;     /* symbols in insertion order */
+    BucketList lastSymbol;
 } *ScopeList;
 
-extern ScopeList currScope;
+/* The record for each interned name. When
+ * ShadowScopes is set, top is the innermost
+ * visible binding of the name and each
+ * binding links to the one it shadows
+ */
+typedef struct NameRec
+{
+    char *name;
+    BucketList top;
+    struct NameRec *next;
+} *NameList;
+
+/* the scope being analyzed; each thread
+ * has its own
+ */
+extern _Thread_local ScopeList currScope;
+
+/* counters kept by st_lookup for the
+ * calling thread
+ */
+typedef struct
+{
+    long lookups; /* st_lookup calls */
+    long probes;  /* records compared */
+    long hops;    /* parent scopes visited */
+    int maxHops;
+    long scopes;  /* scopes opened or entered again */
+} LookupStats;
 
 ScopeList findScope(char *scope);
 ScopeList addScope(char *name);
 
-void st_insert(ScopeList scope, char *name, ExpType type, int lineno, TreeNode *t);
+/* Function preludeScope returns the immutable
+ * root scope holding the built-in functions
+ * (input, output); it is the parent of the
+ * global scope
+ */
+ScopeList preludeScope(void);
+
+/* Function prelude_lookup returns the record
+ * of built-in name, or NULL if there is none
+ */
+BucketList prelude_lookup(char *name);
+
+/* Procedure enterScope makes scope, opened
+ * before by addScope, current again
+ */
+void enterScope(ScopeList scope);
+
+/* Procedure leaveScope closes currScope and
+ * makes its parent current again
+ */
+void leaveScope(void);
+
+/* Function st_slots returns the number of memory
+ * locations taken by the variable declared by t
+ */
+int st_slots(TreeNode *t);
+
+BucketList st_insert(ScopeList scope, char *name, ExpType type, int lineno, TreeNode *t);
 BucketList st_lookup(ScopeList scope, char *name);
 BucketList st_lookup_excluding_parent(ScopeList scope, char *name);
 
+/* Procedure st_setSignature records the arity and
+ * parameter types of function l from its
+ * parameter list
+ */
+void st_setSignature(BucketList l, TreeNode *params);
+
+/* Procedure printSymTab prints a formatted
+ * listing of the symbol table contents
+ * to the listing file
+ */
 void printSymTab(FILE *listing);
 
+/* Procedure printSymTabJSON writes the symbol
+ * table contents as a JSON document
+ */
+void printSymTabJSON(FILE *listing);
+
+/* Procedure st_takeLookupStats moves the st_lookup
+ * counters of the calling thread into stats, and
+ * st_addLookupStats adds them to the calling thread's;
+ * st_getLookupStats copies them
+ */
+void st_takeLookupStats(LookupStats *stats);
+void st_addLookupStats(LookupStats *stats);
+void st_getLookupStats(LookupStats *stats);
+
+/* Procedure printSymTabStats prints scope, symbol,
+ * hash chain, lookup and memory counters
+ */
+void printSymTabStats(FILE *listing);
+
 #endif
@@ -0,0 +1,28 @@
+#!/bin/sh
+# bench.sh: number of TM instructions the benchmark
+# kernels execute at each optimization level; the
+# -O columns add the loop passes, then inlining
+#
+# run from 3_Semantic as  sh test/bench.sh
+# CMINUS and TM name the compiler and simulator
+
+CMINUS=${CMINUS:-./cminus_semantic}
+TM=${TM:-./tm}
+case $CMINUS in /*) ;; *) CMINUS=$PWD/$CMINUS ;; esac
+case $TM in /*) ;; *) TM=$PWD/$TM ;; esac
+dir=$(mktemp -d) || exit 1
+trap 'rm -rf "$dir"' EXIT
+cp test/bench_*.cm "$dir" || exit 1
+cd "$dir" || exit 1
+
+printf '%-8s %10s %10s %10s %10s %10s\n' kernel default -fir '-O noloop' '-O noinl' -O
+for k in matrix sort calls; do
+  printf '%-8s' $k
+  for opts in "" "-fir" "-O -fno-inline -fno-licm -fno-ivsr" "-O -fno-inline" "-O"; do
+    "$CMINUS" bench_$k.cm $opts > /dev/null || exit 1
+    n=$(printf 'p\ng\nq\n' | "$TM" bench_$k.tm | sed -n 's/.*executed = //p')
+    [ -n "$n" ] || { echo; echo "$TM could not run bench_$k.tm" >&2; exit 1; }
+    printf ' %10s' "$n"
+  done
+  echo
+done
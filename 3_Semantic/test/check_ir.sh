@@ -0,0 +1,24 @@
+#!/bin/sh
+# check_ir.sh: checks the IR that -O leaves for
+# test/gvn_loads.cm, where the loads of an element
+# of a global array must be merged or forwarded
+# from the store
+#
+# run from 3_Semantic as  sh test/check_ir.sh
+# CMINUS names the compiler
+
+CMINUS=${CMINUS:-./cminus_semantic}
+case $CMINUS in /*) ;; *) CMINUS=$PWD/$CMINUS ;; esac
+dir=$(mktemp -d) || exit 1
+trap 'rm -rf "$dir"' EXIT
+cp test/gvn_loads.cm "$dir" || exit 1
+cd "$dir" || exit 1
+
+"$CMINUS" --dump-ir -O gvn_loads.cm > gvn_loads.ir || exit 1
+n=$(grep -c ' = load ' gvn_loads.ir)
+if [ "$n" -ne 1 ]; then
+  cat gvn_loads.ir
+  echo "gvn_loads: $n loads left, expected 1" >&2
+  exit 1
+fi
+echo "gvn_loads: ok"
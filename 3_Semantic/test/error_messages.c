@@ -8,3 +8,5 @@ fprintf(listing, "Error: Invalid return at line %d\n", lineno);
 fprintf(listing, "Error: invalid assignment at line %d\n", lineno);
 fprintf(listing, "Error: invalid operation at line %d\n", lineno);
 fprintf(listing, "Error: invalid condition at line %d\n", lineno);
+fprintf(listing, "Error: division by zero at line %d\n", lineno);
+fprintf(listing, "Error: Invalid array indexing at line %d (name : \"%s\"). index is out of bounds\n", lineno, name);
@@ -0,0 +1,39 @@
+#!/bin/sh
+# gen_scopes.sh: writes to standard output a C-Minus
+# program of F functions whose bodies nest D blocks,
+# F*D scopes in all (default 20 functions 200 deep,
+# 4000 scopes); each block declares a variable and
+# reads the parameter, so every lookup walks the
+# scope chain back to the function; the program
+# is for timing the compiler and is too large to
+# load into tm
+#
+# run from 3_Semantic as
+#   sh test/gen_scopes.sh [F [D]] > scopes.cm
+#   ./cminus_semantic -ftime-report scopes.cm
+#   ./cminus_semantic -ftime-report --two-pass scopes.cm
+#   ./cminus_semantic -ftime-report --scopes=shadow scopes.cm
+
+F=${1:-20}
+D=${2:-200}
+awk -v F="$F" -v D="$D" '
+# C-Minus identifiers are letters only
+function name(n,   s) {
+  s = ""
+  do { s = substr("abcdefghijklmnopqrstuvwxyz", n % 26 + 1, 1) s; n = int(n / 26) } while (n > 0)
+  return s
+}
+BEGIN {
+  for (f = 0; f < F; f++) {
+    printf "int f%s(int x)\n{ int v%s;\n  v%s = x;\n", name(f), name(0), name(0)
+    for (d = 1; d < D; d++)
+      printf "{ int v%s;\n  v%s = v%s + x;\n", name(d), name(d), name(d - 1)
+    for (d = 1; d < D; d++)
+      printf "}\n"
+    printf "  return v%s;\n}\n\n", name(0)
+  }
+  printf "void main(void)\n{\n"
+  for (f = 0; f < F; f++)
+    printf "  output(f%s(%d));\n", name(f), f
+  printf "}\n"
+}'
@@ -1,3 +1,54 @@
   0:     LD  6,0(0) 
   1:     ST  0,0(0) 
-  2:   HALT  0,0,0 
+  2:    LDA  7,46(7) 
+  3:     ST  0,-1(6) 
+  4:     LD  0,-3(6) 
+  5:    LDC  1,0(0) 
+  6:    SUB  0,0,1 
+  7:    JNE  0,4(7) 
+  8:     LD  0,-2(6) 
+  9:     LD  1,-1(6) 
+ 10:     LD  6,0(6) 
+ 11:    LDA  7,0(1) 
+ 12:     LD  0,-3(6) 
+ 13:     ST  0,-6(6) 
+ 14:     LD  0,-2(6) 
+ 15:     LD  1,-3(6) 
+ 16:    DIV  0,0,1 
+ 17:     LD  1,-3(6) 
+ 18:    MUL  0,0,1 
+ 19:     LD  1,-2(6) 
+ 20:    SUB  0,1,0 
+ 21:     ST  0,-7(6) 
+ 22:     ST  6,-4(6) 
+ 23:    LDA  6,-4(6) 
+ 24:    LDA  0,1(7) 
+ 25:    LDA  7,-23(7) 
+ 26:     LD  1,-1(6) 
+ 27:     LD  6,0(6) 
+ 28:    LDA  7,0(1) 
+ 29:     LD  1,-1(6) 
+ 30:     LD  6,0(6) 
+ 31:    LDA  7,0(1) 
+ 32:     ST  0,-1(6) 
+ 33:     IN  0,0,0 
+ 34:     ST  0,-2(6) 
+ 35:     IN  0,0,0 
+ 36:     ST  0,-3(6) 
+ 37:     LD  0,-2(6) 
+ 38:     ST  0,-6(6) 
+ 39:     LD  0,-3(6) 
+ 40:     ST  0,-7(6) 
+ 41:     ST  6,-4(6) 
+ 42:    LDA  6,-4(6) 
+ 43:    LDA  0,1(7) 
+ 44:    LDA  7,-42(7) 
+ 45:    OUT  0,0,0 
+ 46:     LD  1,-1(6) 
+ 47:     LD  6,0(6) 
+ 48:    LDA  7,0(1) 
+ 49:     ST  6,0(6) 
+ 50:    LDA  6,0(6) 
+ 51:    LDA  0,1(7) 
+ 52:    LDA  7,-21(7) 
+ 53:   HALT  0,0,0 
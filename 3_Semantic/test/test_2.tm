@@ -1,3 +1,51 @@
   0:     LD  6,0(0) 
   1:     ST  0,0(0) 
-  2:   HALT  0,0,0 
+  2:    LDA  7,43(7) 
+  3:     ST  0,-1(6) 
+  4:    LDC  0,0(0) 
+  5:     ST  0,-2(6) 
+  6:    LDA  7,9(7) 
+  7:     LD  0,-2(6) 
+  8:    LDA  1,-7(6) 
+  9:    ADD  2,1,0 
+ 10:     IN  0,0,0 
+ 11:     ST  0,0(2) 
+ 12:     LD  0,-2(6) 
+ 13:    LDC  1,1(0) 
+ 14:    ADD  0,0,1 
+ 15:     ST  0,-2(6) 
+ 16:     LD  0,-2(6) 
+ 17:    LDC  1,5(0) 
+ 18:    SUB  0,0,1 
+ 19:    JLT  0,-13(7) 
+ 20:    LDC  0,0(0) 
+ 21:     ST  0,-2(6) 
+ 22:    LDA  7,16(7) 
+ 23:     LD  0,-2(6) 
+ 24:    LDA  1,-7(6) 
+ 25:    ADD  0,1,0 
+ 26:     LD  0,0(0) 
+ 27:    LDC  1,0(0) 
+ 28:    SUB  0,0,1 
+ 29:    JEQ  0,7(7) 
+ 30:    LDC  0,6(0) 
+ 31:     ST  0,-9(6) 
+ 32:     LD  0,-2(6) 
+ 33:    LDA  1,-7(6) 
+ 34:    ADD  0,1,0 
+ 35:     LD  0,0(0) 
+ 36:    OUT  0,0,0 
+ 37:    LDC  0,7(0) 
+ 38:     ST  0,-8(6) 
+ 39:     LD  0,-2(6) 
+ 40:    LDC  1,4(0) 
+ 41:    SUB  0,0,1 
+ 42:    JLE  0,-20(7) 
+ 43:     LD  1,-1(6) 
+ 44:     LD  6,0(6) 
+ 45:    LDA  7,0(1) 
+ 46:     ST  6,0(6) 
+ 47:    LDA  6,0(6) 
+ 48:    LDA  0,1(7) 
+ 49:    LDA  7,-47(7) 
+ 50:   HALT  0,0,0 
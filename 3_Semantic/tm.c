@@ -9,6 +9,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "tmb.h"
 
 #ifndef TRUE
 #define TRUE 1
@@ -102,9 +105,21 @@ char *opCodeTab[] = {
 char *stepResultTab[] = {"OK", "Halted", "Instruction Memory Fault",
                          "Data Memory Fault", "Division by 0"};
 
-char pgmName[20];
+char pgmName[120];
 FILE *pgm;
 
+/* the function entries of a binary program */
+TMBSymbol *symTab = NULL;
+int symCount = 0;
+char *symNames = NULL;
+
+/* the number of locations a program fills,
+ * and the data a binary program loads
+ */
+int iCount = 0;
+int dataBase = 0;
+int dataCount = 0;
+
 char in_Line[LINESIZE];
 int lineLen;
 int inCol;
@@ -127,6 +142,10 @@ int opClass(int c)
 /********************************************/
 void writeInstruction(int loc)
 {
+  int i;
+  for (i = 0; i < symCount; i++)
+    if ((int)symTab[i].loc == loc)
+      printf("%s (line %d):\n", symNames + symTab[i].name, symTab[i].lineno);
   printf("%5d: ", loc);
   if ((loc >= 0) && (loc < IADDR_SIZE))
   {
@@ -248,6 +267,72 @@ int error(char *msg, int lineNo, int instNo)
   return FALSE;
 } /* error */
 
+/********************************************/
+/* readBinary maps a .tmb program and loads its
+ * instructions and data
+ */
+int readBinary(void)
+{
+  struct stat st;
+  char *base;
+  TMBHeader *h;
+  TMBInstr *in;
+  int32_t *data;
+  int loc;
+  size_t size;
+  if (fstat(fileno(pgm), &st) != 0 || st.st_size < (off_t)sizeof(TMBHeader))
+    return error("Bad binary file", 0, -1);
+  base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(pgm), 0);
+  if (base == MAP_FAILED)
+    return error("Cannot map binary file", 0, -1);
+  h = (TMBHeader *)base;
+  if (memcmp(h->magic, TMB_MAGIC, 4) != 0 || h->byteOrder != TMB_ORDER)
+    return error("Not a TM binary for this machine", 0, -1);
+  size = sizeof(TMBHeader) + (size_t)h->ninstr * sizeof(TMBInstr) +
+         (size_t)h->ndata * sizeof(int32_t) + (size_t)h->nsyms * sizeof(TMBSymbol) + h->strSize;
+  if ((size_t)st.st_size < size)
+    return error("Truncated binary file", 0, -1);
+  if (h->ninstr > IADDR_SIZE)
+    return error("Location too large", 0, h->ninstr);
+  if (h->dataBase + (size_t)h->ndata > DADDR_SIZE)
+    return error("Data segment too large", 0, h->dataBase);
+  in = (TMBInstr *)(h + 1);
+  for (loc = 0; loc < (int)h->ninstr; loc++, in++)
+  {
+    if (in->op >= opRALim || in->op == opRRLim || in->op == opRMLim)
+      return error("Illegal opcode", 0, loc);
+    if (in->r >= NO_REGS || in->s >= NO_REGS || in->t >= NO_REGS)
+      return error("Bad register", 0, loc);
+    iMem[loc].iop = in->op;
+    iMem[loc].iarg1 = in->r;
+    if (opClass(in->op) == opclRR)
+    {
+      iMem[loc].iarg2 = in->s;
+      iMem[loc].iarg3 = in->t;
+    }
+    else
+    {
+      iMem[loc].iarg2 = in->d;
+      iMem[loc].iarg3 = in->s;
+    }
+  }
+  iCount = h->ninstr;
+  dataBase = h->dataBase;
+  dataCount = h->ndata;
+  data = (int32_t *)in;
+  for (loc = 0; loc < (int)h->ndata; loc++)
+    dMem[h->dataBase + loc] = data[loc];
+  symTab = (TMBSymbol *)(data + h->ndata);
+  symCount = h->nsyms;
+  symNames = (char *)(symTab + symCount);
+  for (loc = 0; loc < symCount; loc++)
+    if (symTab[loc].name >= h->strSize)
+      return error("Bad symbol name", 0, loc);
+  if (h->strSize > 0 && symNames[h->strSize - 1] != '\0')
+    return error("Bad string table", 0, -1);
+  return TRUE;
+} /* readBinary */
+
 /********************************************/
 int readInstructions(void)
 {
@@ -266,6 +351,9 @@ int readInstructions(void)
     iMem[loc].iarg2 = 0;
     iMem[loc].iarg3 = 0;
   }
+  lineNo = strlen(pgmName);
+  if (lineNo > 4 && strcmp(pgmName + lineNo - 4, ".tmb") == 0)
+    return readBinary();
   lineNo = 0;
   while (!feof(pgm))
   {
@@ -330,6 +418,8 @@ int readInstructions(void)
         arg3 = num;
         break;
       }
+      if (loc >= iCount)
+        iCount = loc + 1;
       iMem[loc].iop = op;
       iMem[loc].iarg1 = arg1;
       iMem[loc].iarg2 = arg2;
@@ -339,6 +429,30 @@ int readInstructions(void)
   return TRUE;
 } /* readInstructions */
 
+/********************************************/
+/* disassemble prints the program read as TM
+ * text, which readInstructions reads back; the
+ * function entries and the data of a binary
+ * program become comments
+ */
+void disassemble(void)
+{
+  int loc, i;
+  for (loc = 0; loc < iCount; loc++)
+  {
+    for (i = 0; i < symCount; i++)
+      if ((int)symTab[i].loc == loc)
+        printf("* %s (line %d)\n", symNames + symTab[i].name, symTab[i].lineno);
+    printf("%3d:  %5s  %d,", loc, opCodeTab[iMem[loc].iop], iMem[loc].iarg1);
+    if (opClass(iMem[loc].iop) == opclRR)
+      printf("%d,%d\n", iMem[loc].iarg2, iMem[loc].iarg3);
+    else
+      printf("%d(%d)\n", iMem[loc].iarg2, iMem[loc].iarg3);
+  }
+  for (loc = 0; loc < dataCount; loc++)
+    printf("* data %d: %d\n", dataBase + loc, dMem[dataBase + loc]);
+} /* disassemble */
+
 /********************************************/
 STEPRESULT stepTM(void)
 {
@@ -663,15 +777,17 @@ int doCommand(void)
 
 main(int argc, char *argv[])
 {
-  if (argc != 2)
+  int dis = argc == 3 && strcmp(argv[1], "-d") == 0;
+  if ((argc != 2 && !dis) || argv[argc - 1][0] == '-')
   {
-    printf("usage: %s <filename>\n", argv[0]);
+    printf("usage: %s [-d] <filename>\n", argv[0]);
+    printf("  -d  print the program as TM text instead of running it\n");
     exit(1);
   }
-  strcpy(pgmName, argv[1]);
+  strncpy(pgmName, argv[argc - 1], sizeof(pgmName) - 5);
   if (strchr(pgmName, '.') == NULL)
     strcat(pgmName, ".tm");
-  pgm = fopen(pgmName, "r");
+  pgm = fopen(pgmName, "rb");
   if (pgm == NULL)
   {
     printf("file '%s' not found\n", pgmName);
@@ -681,6 +797,11 @@ main(int argc, char *argv[])
   /* read the program */
   if (!readInstructions())
     exit(1);
+  if (dis)
+  {
+    disassemble();
+    return 0;
+  }
   /* switch input file to terminal */
   /* reset( input ); */
   /* read-eval-print */
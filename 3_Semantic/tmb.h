@@ -0,0 +1,63 @@
+/****************************************************/
+/* File: tmb.h                                      */
+/* Binary object format (.tmb) for the TM machine,  */
+/* shared by the compiler and the simulator         */
+/****************************************************/
+
+#ifndef _TMB_H_
+#define _TMB_H_
+
+#include <stdint.h>
+
+/* A .tmb file is laid out as
+ *   TMBHeader
+ *   TMBInstr   instrs[ninstr]     location 0 first
+ *   int32_t    data[ndata]        loaded at dataBase
+ *   TMBSymbol  syms[nsyms]
+ *   char       strings[strSize]   names, NUL terminated
+ * All fields are in the byte order of the writer;
+ * the simulator rejects a file whose byteOrder
+ * does not read as TMB_ORDER
+ */
+#define TMB_MAGIC "TMB1"
+#define TMB_ORDER 0x01020304u
+
+typedef struct
+{
+  char magic[4];
+  uint32_t byteOrder;
+  uint32_t ninstr;
+  uint32_t dataBase;
+  uint32_t ndata;
+  uint32_t nsyms;
+  uint32_t strSize;
+  uint32_t reserved;
+} TMBHeader;
+
+/* an instruction: op is the opcode number of
+ * the simulator's opcode table; RO instructions
+ * use r,s,t, RM and RA instructions r, d and
+ * the base register s. Unused locations hold
+ * HALT 0,0,0
+ */
+typedef struct
+{
+  uint8_t op;
+  uint8_t r;
+  uint8_t s;
+  uint8_t t;
+  int32_t d;
+} TMBInstr;
+
+/* a named code location (function entry) with
+ * its source line; name is an offset into the
+ * string table
+ */
+typedef struct
+{
+  uint32_t loc;
+  int32_t lineno;
+  uint32_t name;
+} TMBSymbol;
+
+#endif
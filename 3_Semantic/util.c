@@ -102,6 +102,17 @@ void printToken(TokenType token, const char *tokenString)
   }
 }
 
+/* ids handed out to new tree nodes */
+static int nextId = 1;
+
+/* Function maxNodeId returns the largest id
+ * given to a tree node so far
+ */
+int maxNodeId(void)
+{
+  return nextId - 1;
+}
+
 /* Function newStmtNode creates a new statement
  * node for syntax tree construction
  */
@@ -116,9 +127,14 @@ TreeNode *newStmtNode(StmtKind kind)
     for (i = 0; i < MAXCHILDREN; i++)
       t->child[i] = NULL;
     t->sibling = NULL;
+    t->symbol = NULL;
+    t->scope = NULL;
     t->nodekind = StmtK;
     t->kind.stmt = kind;
+    t->type = Void;
+    t->id = nextId++;
     t->lineno = lineno;
+    t->colno = colno;
   }
   return t;
 }
@@ -137,9 +153,13 @@ TreeNode *newExpNode(ExpKind kind)
     for (i = 0; i < MAXCHILDREN; i++)
       t->child[i] = NULL;
     t->sibling = NULL;
+    t->symbol = NULL;
+    t->scope = NULL;
     t->nodekind = ExpK;
     t->kind.exp = kind;
+    t->id = nextId++;
     t->lineno = lineno;
+    t->colno = colno;
     t->type = Void;
   }
   return t;
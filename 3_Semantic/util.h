@@ -28,6 +28,11 @@ TreeNode *newExpNode(ExpKind);
  */
 char *copyString(char *);
 
+/* Function maxNodeId returns the largest id
+ * given to a tree node so far
+ */
+int maxNodeId(void);
+
 /* procedure printTree prints a syntax tree to the
  * listing file using indentation to indicate subtrees
  */